@@ -0,0 +1,44 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "Budget.hpp"
+
+#include <fstream>
+#include <unistd.h>
+
+using namespace qbm;
+
+Budget::Budget(double const  seconds, size_t const  megabytes)
+  : m_deadline(std::chrono::steady_clock::now() +
+	       std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds))),
+    m_timed(seconds > 0), m_memory(megabytes << 20) {}
+
+size_t Budget::resident() {
+  // Second field of statm: resident set size in pages
+  std::ifstream  in("/proc/self/statm");
+  size_t  size, pages;
+  if(in >> size >> pages)  return  pages * sysconf(_SC_PAGESIZE);
+  return  0;
+}
+
+Result Budget::exhausted() const {
+  if(m_timed && (std::chrono::steady_clock::now() >= m_deadline))  return  QUANTOR_RESULT_TIMEOUT;
+  if(m_memory && (resident() > m_memory))  return  QUANTOR_RESULT_SPACEOUT;
+  return  QUANTOR_RESULT_UNKNOWN;
+}
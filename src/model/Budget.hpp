@@ -0,0 +1,62 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef BUDGET_HPP
+#define BUDGET_HPP
+
+#include "Result.hpp"
+
+#include <chrono>
+#include <cstddef>
+
+namespace qbm {
+/**
+ * This class describes the resources granted to a solution engine: a
+ * wall-clock time budget starting with the construction of the Budget
+ * and a bound on the resident memory of the whole process. A zero
+ * amount leaves the respective resource unlimited.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class Budget {
+  std::chrono::steady_clock::time_point  m_deadline;
+  bool                                   m_timed;
+  size_t                                 m_memory;  // bytes
+
+  //- Construction / Destruction
+public:
+  Budget(double const  seconds = 0, size_t const  megabytes = 0);
+  ~Budget() {}
+
+  //- Information
+public:
+  bool unlimited() const { return !m_timed && (m_memory == 0); }
+
+  /** The resident memory of this process in bytes. */
+  static size_t resident();
+
+  /**
+   * Checks the budget.
+   * @return QUANTOR_RESULT_TIMEOUT or QUANTOR_RESULT_SPACEOUT if the
+   *         respective resource is exhausted, QUANTOR_RESULT_UNKNOWN otherwise
+   */
+  Result exhausted() const;
+};
+}
+#endif
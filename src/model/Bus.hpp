@@ -22,11 +22,52 @@
 
 #include "Node.hpp"
 
-#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
 
+/**
+ * An immutable vector of nodes with value semantics. Buses of up to INLINE
+ * nodes are stored within the Bus itself. Wider buses share a single
+ * allocation holding the nodes and a reference count, which is not atomic:
+ * a bus must not be copied, released or read by several threads at once.
+ *
+ * Wide slices are views into the storage of the sliced bus. Wide
+ * concatenations only keep their segments until their nodes are read so
+ * that slicing them again does not copy any nodes.
+ */
 class Bus {
-  unsigned                     m_width;
-  std::shared_ptr<Node const>  m_nodes;
+  static unsigned const  INLINE   = 4;
+  static unsigned const  MAX_SEGS = 8;
+
+  /**
+   * The shared storage of a wide bus. A pending concatenation keeps its
+   * segments, lowest first, behind the nodes until they are read.
+   */
+  struct Block {
+    unsigned  refs;
+    unsigned  size;  // nodes
+    unsigned  segs;  // pending segments, 0 once flat
+    int       nodes[1];
+
+    static size_t segmentsOffset(unsigned const  size) {
+      size_t const  ofs = offsetof(Block, nodes) + size*sizeof(int);
+      return (ofs + alignof(Bus)-1) & ~(alignof(Bus)-1);
+    }
+    Bus* segments() {
+      return  reinterpret_cast<Bus*>(reinterpret_cast<char*>(this) + segmentsOffset(size));
+    }
+  };
+
+  struct Blank {};
+
+  unsigned  m_width;
+  unsigned  m_offset;  // of a view into a shared block
+  union {
+    int     m_inline[INLINE];
+    Block  *m_block;
+  };
 
 private:
   static unsigned computeBitWidth(unsigned  val) {
@@ -34,56 +75,181 @@ private:
     for(unsigned  v = val; v != 0; v >>= 1)  width++;
     return  width;
   }
+
+  static Block* allocate(unsigned const  size, unsigned const  segs) {
+    Block *const  blk = static_cast<Block*>(::operator new(segs == 0?
+		          offsetof(Block, nodes) + size*sizeof(int) :
+		          Block::segmentsOffset(size) + segs*sizeof(Bus)));
+    blk->refs = 1;
+    blk->size = size;
+    blk->segs = segs;
+    return  blk;
+  }
+  static void discard(Block &blk) {
+    Bus *const  segs = blk.segments();
+    for(unsigned  i = 0; i < blk.segs; i++)  segs[i].~Bus();
+    blk.segs = 0;
+  }
+  static void flatten(Block &blk) {
+    Bus const *const  segs = blk.segments();
+    int       *dst = blk.nodes;
+    for(unsigned  i = 0; i < blk.segs; i++) {
+      int const *const  src = segs[i].data();
+      dst = std::copy(src, src+segs[i].m_width, dst);
+    }
+    discard(blk);
+  }
+
+  bool shared() const { return  m_width > INLINE; }
+  bool pending() const { return  shared() && (m_block->segs != 0); }
+  int const* data() const {
+    if(!shared())  return  m_inline;
+    if(m_block->segs != 0)  flatten(*m_block);
+    return  m_block->nodes + m_offset;
+  }
+  int* data() { return  shared()? m_block->nodes + m_offset : m_inline; }
+
+  /** The number of segments this bus contributes to a concatenation. */
+  unsigned pieces() const {
+    return  pending() && (m_offset == 0) && (m_width == m_block->size)? m_block->segs : 1;
+  }
+  Bus* splice(Bus *dst) const {
+    if(pieces() == 1)  return  new(dst) Bus(*this) + 1;
+    Bus const *const  segs = m_block->segments();
+    for(unsigned  i = 0; i < m_block->segs; i++)  new(dst++) Bus(segs[i]);
+    return  dst;
+  }
+
+  void acquire() {
+    if(shared())  m_block->refs++;
+  }
+  void release() {
+    if(shared() && (--m_block->refs == 0)) {
+      discard(*m_block);
+      ::operator delete(m_block);
+    }
+  }
+
+  /** Creates a bus of the given width with its nodes or segments still to be set. */
+  Bus(unsigned  width, Blank, unsigned  segs = 0) : m_width(width), m_offset(0), m_block(nullptr) {
+    if(shared())  m_block = allocate(width, segs);
+  }
+
 public:
-  Bus() : m_width(0) {}
+  Bus() : m_width(0), m_offset(0), m_block(nullptr) {}
   Bus(unsigned  val) : Bus(val, computeBitWidth(val)) {}
-  Bus(unsigned  val, unsigned  width) : m_width(width) {
-    if(width > 0) {
-      Node *const  bus = new Node[width];
-      for(unsigned  i = 0; i < width; i++) {
-	bus[i] = val&1? Node::TOP : Node::BOT;
-	val >>= 1;
-      }
-      m_nodes.reset(bus);
+  Bus(unsigned  val, unsigned  width) : Bus(width, Blank()) {
+    int *const  dst = data();
+    for(unsigned  i = 0; i < width; i++) {
+      dst[i] = val&1? Node::TOP : Node::BOT;
+      val >>= 1;
     }
   }
-  Bus(unsigned const  width, Node const* nodes)
-    : m_width(width), m_nodes(nodes) {}
-  Bus(unsigned const  width, std::shared_ptr<Node const> nodes)
-    : m_width(width), m_nodes(nodes) {}
-  ~Bus() {}
+  Bus(Bus const &o) : m_width(o.m_width), m_offset(o.m_offset) {
+    if(shared())  m_block = o.m_block;
+    else  std::copy(o.m_inline, o.m_inline+INLINE, m_inline);
+    acquire();
+  }
+  Bus(Bus &&o) : Bus() { swap(o); }
+  Bus& operator=(Bus const &o) {
+    Bus(o).swap(*this);
+    return *this;
+  }
+  Bus& operator=(Bus &&o) {
+    Bus(std::move(o)).swap(*this);
+    return *this;
+  }
+  ~Bus() { release(); }
+
+  void swap(Bus &o) {
+    std::swap(m_width,  o.m_width);
+    std::swap(m_offset, o.m_offset);
+    int  tmp[INLINE];
+    std::copy(m_inline, m_inline+INLINE, tmp);
+    std::copy(o.m_inline, o.m_inline+INLINE, m_inline);
+    std::copy(tmp, tmp+INLINE, o.m_inline);
+  }
+
+public:
+  /**
+   * Creates a bus of the given width whose nodes are computed by fill(i).
+   * The nodes are computed in ascending or, if reverse, in descending order.
+   */
+  template<typename F>
+  static Bus build(unsigned const  width, F const &fill, bool const  reverse = false) {
+    Bus   res(width, Blank());
+    int *const  dst = res.data();
+    if(reverse) { for(unsigned  i = width; i-- > 0;)  dst[i] = fill(i); }
+    else        { for(unsigned  i = 0; i < width; i++)  dst[i] = fill(i); }
+    return  res;
+  }
 
 public:
   unsigned width() const { return  m_width; }
 
   Node operator[](unsigned const  ofs) const {
-    return (ofs >= m_width)? Node(Node::BOT) : m_nodes.get()[ofs];
+    return (ofs >= m_width)? Node(Node::BOT) : Node(data()[ofs]);
   }
   Bus operator()(unsigned const  beg, unsigned const  end) const {
     if(end < beg)  return  Bus();
 
-    Node const *const  src = m_nodes.get();
-    unsigned    const  len = end-beg+1;
-    Node       *const  dst = new Node[len];
+    unsigned const  len = end-beg+1;
+    if(shared() && (end < m_width)) {
+      if(m_block->segs != 0) {
+	// Slice of a single segment of a pending concatenation?
+	Bus const *const  segs = m_block->segments();
+	unsigned const  b  = m_offset + beg;
+	unsigned const  e  = m_offset + end;
+	unsigned        lo = 0;
+	for(unsigned  i = 0; (i < m_block->segs) && (lo <= b); lo += segs[i++].m_width) {
+	  if(e < lo + segs[i].m_width)  return  segs[i](b-lo, e-lo);
+	}
+      }
+      if(len > INLINE) {
+	// View into the shared block
+	Bus  res(*this);
+	res.m_offset += beg;
+	res.m_width   = len;
+	return  res;
+      }
+    }
+
+    int const *const  src = data();
+    Bus   res(len, Blank());
+    int  *const  dst = res.data();
     if(end < m_width)  std::copy(src+beg, src+end+1, dst);
     else if(beg < m_width) {
       std::copy(src+beg, src+m_width, dst);
-      std::fill(dst+(m_width-beg), dst+len, Node(Node::BOT));
+      std::fill(dst+(m_width-beg), dst+len, (int)Node::BOT);
     }
-    else  std::fill(dst, dst+len, Node(Node::BOT));
-    return  Bus(len, dst);
+    else  std::fill(dst, dst+len, (int)Node::BOT);
+    return  res;
   }
   Bus operator~() const {
-    Node const *const  src = m_nodes.get();
-    Node       *const  dst = new Node[m_width];
+    int const *const  src = data();
+    Bus   res(m_width, Blank());
+    int  *const  dst = res.data();
     for(unsigned  i = 0; i < m_width; i++)  dst[i] = -src[i];
-    return  Bus(m_width, dst);
+    return  res;
   }
   Bus operator,(Bus const &o) const {
-    Node *const  dst = new Node[m_width + o.m_width];
-    std::copy(o.m_nodes.get(), o.m_nodes.get()+o.m_width, dst);
-    std::copy(m_nodes.get(), m_nodes.get()+m_width, dst+o.m_width);
-    return  Bus(m_width+o.m_width, dst);
+    if(o.m_width == 0)  return *this;
+    if(  m_width == 0)  return  o;
+
+    unsigned const  width = m_width + o.m_width;
+    unsigned const  segs  = o.pieces() + pieces();
+    if((width > INLINE) && (segs <= MAX_SEGS)) {
+      // Defer copying the nodes of the operands
+      Bus  res(width, Blank(), segs);
+      splice(o.splice(res.m_block->segments()));
+      return  res;
+    }
+
+    Bus   res(width, Blank());
+    int  *const  dst = res.data();
+    std::copy(o.data(), o.data()+o.m_width, dst);
+    std::copy(data(), data()+m_width, dst+o.m_width);
+    return  res;
   }
 };
 #endif
@@ -0,0 +1,213 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "Cegar.hpp"
+#include "Ipasir.hpp"
+
+#include <map>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace qbm;
+
+char const* Cegar::version() const {
+  return  "CEGAR";
+}
+char const* Cegar::backend() const {
+  return  m_lib.signature();
+}
+
+int Cegar::findCounterexample(Ipasir &verifier,
+			      std::vector<int> const &config,
+			      std::vector<int>       &inputs) const {
+  int const  nv = m_kinds.size()-1;
+
+  // Input Vectors yet to be refuted, extended by one auxiliary variable
+  // per matrix clause that may fail under a verification witness
+  Ipasir  generator(m_lib);
+  int     auxnxt = nv+1;
+  terminate(generator);
+
+  std::map<std::vector<int>, int>  violated;  // aux by input projection
+  std::vector<int>                 clause;
+  while(true) {
+    if(interrupted())  return  0;
+    switch(generator.solve()) {
+    case 10:
+      break;
+    case 20:
+      return  20; // no counterexample
+    default:
+      return  0;
+    }
+
+    inputs.clear();
+    for(int  v = 1; v <= nv; v++) {
+      if(m_kinds[v] == Kind::INPUT)  inputs.push_back(generator.val(v) > 0? v : -v);
+    }
+
+    for(int  lit : config)  verifier.assume(lit);
+    for(int  lit : inputs)  verifier.assume(lit);
+    switch(verifier.solve()) {
+    case 20:
+      return  10; // counterexample
+    case 10:
+      break;
+    default:
+      return  0;
+    }
+
+    // The witness signals of the verifier satisfy the matrix for all input
+    // vectors that satisfy the input projection of each clause not already
+    // satisfied by the configuration and the witness signals themselves.
+    std::vector<int>  aux;
+    auto  it = m_clauses.begin();
+    while(it != m_clauses.end()) {
+      bool  sat = false;
+      clause.clear();
+      for(int  lit; (lit = *it++) != 0;) {
+	switch(m_kinds[std::abs(lit)]) {
+	case Kind::INPUT:
+	  clause.push_back(lit);
+	  break;
+	default:
+	  if((verifier.val(std::abs(lit)) > 0) == (lit > 0))  sat = true;
+	  break;
+	}
+      }
+      if(sat || clause.empty())  continue;
+
+      // aux -> clause is violated
+      std::sort(clause.begin(), clause.end());
+      auto const  res = violated.emplace(clause, auxnxt);
+      int  const  a   = res.first->second;
+      if(res.second) {
+	auxnxt++;
+	for(int  lit : clause) {
+	  generator.add(-a);
+	  generator.add(-lit);
+	  generator.add(0);
+	}
+      }
+      aux.push_back(a);
+    }
+    // The witness covers all input vectors not forced to violate one of
+    // the remaining clauses.
+    for(int  a : aux)  generator.add(a);
+    generator.add(0);
+  }
+}
+
+Result Cegar::sat() {
+  int const  nv = m_kinds.size()-1;
+  std::vector<int> const  assumptions(std::move(m_assumptions));
+  m_assumptions.clear();
+
+  if(!m_verifier) {
+    // Verifier: plain matrix, configuration and inputs fixed by assumptions
+    m_verifier.reset(new Ipasir(m_lib));
+    terminate(*m_verifier);
+    for(int  lit : m_clauses)  m_verifier->add(lit);
+
+    // Candidate: configuration with one matrix copy per counterexample,
+    //   clauses only over configs are shared by all copies
+    m_candidate.reset(new Ipasir(m_lib));
+    terminate(*m_candidate);
+    m_signxt = nv+1;
+    auto  it = m_clauses.begin();
+    while(it != m_clauses.end()) {
+      auto  beg = it;
+      bool  shared = true;
+      for(int  lit; (lit = *it++) != 0;) {
+	if(m_kinds[std::abs(lit)] != Kind::CONFIG)  shared = false;
+      }
+      if(shared) {
+	while(beg < it)  m_candidate->add(*beg++);
+      }
+    }
+  }
+  Ipasir &verifier  = *m_verifier;
+  Ipasir &candidate = *m_candidate;
+  for(int  lit : m_constraints)  candidate.add(lit);
+  m_constraints.clear();
+
+  std::vector<int>  config;
+  std::vector<int>  inputs;
+  std::vector<int>  map(nv+1);
+  std::vector<int>  clause;
+  while(true) {
+    if(interrupted())  return  QUANTOR_RESULT_UNKNOWN;
+    for(int  lit : assumptions)  candidate.assume(lit);
+    switch(candidate.solve()) {
+    case 10:
+      break;
+    case 20:
+      return  QUANTOR_RESULT_UNSATISFIABLE;
+    default:
+      return  QUANTOR_RESULT_UNKNOWN;
+    }
+
+    config.clear();
+    for(int  v = 1; v <= nv; v++) {
+      if(m_kinds[v] == Kind::CONFIG)  config.push_back(candidate.val(v) > 0? v : -v);
+    }
+
+    switch(findCounterexample(verifier, config, inputs)) {
+    case 10:
+      break;
+    case 20:
+      m_assignment = config;
+      m_assignment.push_back(0);
+      return  QUANTOR_RESULT_SATISFIABLE;
+    default:
+      return  QUANTOR_RESULT_UNKNOWN;
+    }
+    m_iterations++;
+
+    // Build the variable map for the matrix copy of this counterexample:
+    //   configs are shared, inputs are fixed and signals are fresh
+    for(int  v = 1; v <= nv; v++) {
+      switch(m_kinds[v]) {
+      case Kind::CONFIG: map[v] = v;          break;
+      case Kind::INPUT:  map[v] = 0;          break;
+      default:           map[v] = m_signxt++; break;
+      }
+    }
+    for(int  lit : inputs)  map[std::abs(lit)] = lit;
+
+    // Add the simplified matrix copy
+    auto  it = m_clauses.begin();
+    while(it != m_clauses.end()) {
+      bool  sat    = false;
+      bool  shared = true;
+      clause.clear();
+      for(int  lit; (lit = *it++) != 0;) {
+	int const  v = std::abs(lit);
+	if(m_kinds[v] != Kind::CONFIG)  shared = false;
+	if(m_kinds[v] == Kind::INPUT) {
+	  if((map[v] > 0) == (lit > 0))  sat = true;
+	}
+	else  clause.push_back(lit > 0? map[v] : -map[v]);
+      }
+      if(sat || shared)  continue;
+      for(int  lit : clause)  candidate.add(lit);
+      candidate.add(0);
+    }
+  }
+}
@@ -0,0 +1,79 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef CEGAR_HPP
+#define CEGAR_HPP
+
+#include "Formula.hpp"
+#include "Ipasir.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace qbm {
+
+/**
+ * This class implements a counterexample-guided solver for the
+ * quantified formulas collected by a Formula.
+ *
+ * A candidate SAT instance only knows about the configuration and one copy
+ * of the matrix per counterexample input vector seen so far. A verification
+ * SAT instance holding the plain matrix checks candidate configurations
+ * under assumptions and, thus, finds the input vectors the candidate fails
+ * for.
+ *
+ * Both SAT instances persist across sat() calls under different
+ * assumptions so that the learned clauses and the matrix copies of the
+ * counterexamples are reused.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class Cegar : public Formula {
+  IpasirLib const          m_lib;         // SAT solver backend
+  unsigned                 m_iterations;  // counterexamples processed
+  std::unique_ptr<Ipasir>  m_verifier;
+  std::unique_ptr<Ipasir>  m_candidate;
+  int                      m_signxt;      // next signal of the candidate
+
+  //- Construction / Destruction
+public:
+  Cegar(IpasirLib const &lib = IpasirLib()) : m_lib(lib), m_iterations(0), m_signxt(0) {}
+  ~Cegar() {}
+
+  //- Information
+public:
+  char const* version() const;
+  char const* backend() const;
+  unsigned iterations() const { return  m_iterations; }
+
+  //- Solving
+public:
+  Result sat();
+
+private:
+  /**
+   * Searches an input vector the given configuration fails for.
+   * @return 10 if found, 20 if there is none and 0 if the search was aborted
+   */
+  int findCounterexample(Ipasir &verifier,
+			 std::vector<int> const &config,
+			 std::vector<int>       &inputs) const;
+};
+}
+#endif
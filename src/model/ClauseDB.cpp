@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "ClauseDB.hpp"
+
+#include <cstdlib>
+#include <algorithm>
+
+size_t ClauseDB::hash(int const *beg, int const *end) const {
+  size_t  h = end-beg;
+  while(beg < end)  h = 31*h + (unsigned)*beg++;
+  return  h ^ (h >> 16);
+}
+
+unsigned ClauseDB::probe(int const *beg, int const *end) const {
+  unsigned const  mask = m_index.size()-1;
+  unsigned        i    = hash(beg, end) & mask;
+  while(true) {
+    unsigned const  id = m_index[i];
+    if(id == 0)  return  i;
+    if((this->end(id-1) - begin(id-1) == end-beg) && std::equal(beg, end, begin(id-1)))  return  i;
+    i = (i+1) & mask;
+  }
+}
+
+void ClauseDB::grow() {
+  std::vector<unsigned>  index(m_index.empty()? 1024 : 2*m_index.size(), 0);
+  m_index.swap(index);
+  for(unsigned  id = 0; id < size(); id++)  m_index[probe(begin(id), end(id))] = id+1;
+}
+
+bool ClauseDB::add(int const *beg, int const *end) {
+  // Normalize in place at the end of the literals
+  unsigned const  start = m_lits.size();
+  m_lits.insert(m_lits.end(), beg, end);
+  int *const  first = m_lits.data() + start;
+  int *const  last  = m_lits.data() + m_lits.size();
+  std::sort(first, last, [](int  a, int  b) {
+      return  std::abs(a) < std::abs(b) || (std::abs(a) == std::abs(b) && a < b);
+    });
+  int *const  stop = std::unique(first, last);
+  for(int *it = first; it+1 < stop; it++) {
+    if(*it == -it[1]) {
+      // Tautology
+      m_lits.resize(start);
+      return  false;
+    }
+  }
+  m_lits.resize(stop - m_lits.data());
+
+  // Look up an identical clause
+  if(2*(size()+1) > m_index.size())  grow();
+  unsigned const  slot = probe(m_lits.data()+start, m_lits.data()+m_lits.size());
+  if(m_index[slot] != 0) {
+    m_lits.resize(start);
+    return  false;
+  }
+  m_index[slot] = size()+1;
+  m_starts.push_back(m_lits.size());
+  return  true;
+}
+
+void ClauseDB::clear() {
+  std::vector<int>().swap(m_lits);
+  std::vector<unsigned>(1, 0).swap(m_starts);
+  std::vector<unsigned>().swap(m_index);
+}
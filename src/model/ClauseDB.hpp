@@ -0,0 +1,87 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef CLAUSEDB_HPP
+#define CLAUSEDB_HPP
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * A set of clauses addressed by dense clause IDs. Each clause is stored
+ * normalized with its literals sorted by variable, repeated literals merged
+ * and tautologies dropped. A flat hash index over the clause contents
+ * keeps every clause only once.
+ */
+class ClauseDB {
+  std::vector<int>       m_lits;    // literals of all clauses in sequence
+  std::vector<unsigned>  m_starts;  // of each clause with trailing end
+  std::vector<unsigned>  m_index;   // clause IDs + 1 by hash, 0: empty
+
+public:
+  ClauseDB() : m_starts(1, 0) {}
+  ClauseDB(ClauseDB const&) = delete;
+  ClauseDB& operator=(ClauseDB const&) = delete;
+  ~ClauseDB() {}
+
+private:
+  size_t hash(int const *beg, int const *end) const;
+  /** The index slot holding the given clause or the empty slot for it. */
+  unsigned probe(int const *beg, int const *end) const;
+  void grow();
+
+public:
+  unsigned size()  const { return  m_starts.size()-1; }
+  bool     empty() const { return  size() == 0; }
+
+  int const* begin(unsigned const  id) const { return  m_lits.data() + m_starts[id]; }
+  int const* end  (unsigned const  id) const { return  m_lits.data() + m_starts[id+1]; }
+
+  /** All literals of all clauses. */
+  std::vector<int> const& literals() const { return  m_lits; }
+
+  template<typename F>
+  void forEach(F &&f) const {
+    for(unsigned  id = 0; id < size(); id++)  f(begin(id), end(id));
+  }
+
+public:
+  /**
+   * Adds the clause over the literals [beg, end) after normalizing it.
+   * @return whether the clause has been added, i.e. was neither
+   *         tautological nor present already
+   */
+  bool add(int const *beg, int const *end);
+
+  /**
+   * Renames all literals in place. The mapping must preserve both the
+   * signs and the order of the variables so that the clauses stay
+   * normalized and distinct.
+   */
+  template<typename F>
+  void rename(F &&f) {
+    for(int &lit : m_lits)  f(lit);
+    std::vector<unsigned>  index(m_index.size(), 0);
+    m_index.swap(index);
+    for(unsigned  id = 0; id < size(); id++)  m_index[probe(begin(id), end(id))] = id+1;
+  }
+
+  void clear();
+};
+#endif
@@ -0,0 +1,47 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "ClauseSink.hpp"
+
+void QDimacsWriter::prefix(unsigned  configs, unsigned  inputs, unsigned  signals, unsigned long  clauses) {
+  m_out << "p cnf " << (configs + inputs + signals) << ' ' << clauses << '\n';
+
+  // Existential Configs, universal Inputs, existential Signals:
+  //   empty Blocks, as after preprocessing, are left out
+  int   v    = 1;
+  char  open = '\0'; // quantifier of the current block
+  auto const  block = [this, &v, &open](char const  quant, unsigned  n) {
+    if(n == 0)  return;
+    if(quant != open) {
+      if(open)  m_out << "0\n";
+      m_out << quant << ' ';
+      open = quant;
+    }
+    while(n-- > 0)  m_out << v++ << ' ';
+  };
+  block('e', configs);
+  block('a', inputs);
+  block('e', signals);
+  if(open)  m_out << "0\n";
+}
+
+void QDimacsWriter::clause(int const *beg, int const *end) {
+  while(beg < end)  m_out << *beg++ << ' ';
+  m_out << "0\n";
+}
@@ -0,0 +1,97 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef CLAUSESINK_HPP
+#define CLAUSESINK_HPP
+
+#include "Result.hpp"
+
+#include <ostream>
+
+/**
+ * This class receives a quantified formula of the form
+ *   exists config: forall inputs: exists signals: matrix
+ * clause by clause. The variables are numbered densely from 1 with the
+ * configs first, followed by the inputs and, finally, the signals.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class ClauseSink {
+  //- Construction / Destruction
+protected:
+  ClauseSink() {}
+public:
+  virtual ~ClauseSink() {}
+
+  //- Formula Reception
+public:
+  /** Opens the formula with the sizes of the variable ranges. */
+  virtual void prefix(unsigned  configs, unsigned  inputs, unsigned  signals, unsigned long  clauses) = 0;
+
+  /** Adds the clause over the literals in [beg, end). */
+  virtual void clause(int const *beg, int const *end) = 0;
+};
+
+/**
+ * This class writes the received formula in the QDIMACS format.
+ */
+class QDimacsWriter : public ClauseSink {
+  std::ostream &m_out;
+
+public:
+  QDimacsWriter(std::ostream &out) : m_out(out) {}
+  ~QDimacsWriter() {}
+
+public:
+  void prefix(unsigned  configs, unsigned  inputs, unsigned  signals, unsigned long  clauses) override;
+  void clause(int const *beg, int const *end) override;
+};
+
+/**
+ * This class feeds the received formula through the problem construction
+ * interface of a solver engine like qbm::Quantor or a qbm::Formula.
+ */
+template<typename Solver>
+class SolverSink : public ClauseSink {
+  Solver &m_solver;
+
+public:
+  SolverSink(Solver &solver) : m_solver(solver) {}
+  ~SolverSink() {}
+
+public:
+  void prefix(unsigned  configs, unsigned  inputs, unsigned  signals, unsigned long) override {
+    int  v = 1;
+    scope(QUANTOR_EXISTENTIAL_VARIABLE_TYPE, v, configs);
+    scope(QUANTOR_UNIVERSAL_VARIABLE_TYPE,   v, inputs);
+    scope(QUANTOR_EXISTENTIAL_VARIABLE_TYPE, v, signals);
+  }
+  void clause(int const *beg, int const *end) override {
+    while(beg < end)  m_solver.add(*beg++);
+    m_solver.add(0);
+  }
+
+private:
+  void scope(::QuantorQuantificationType const  quant, int &v, unsigned  n) {
+    m_solver.scope(quant);
+    while(n-- > 0)  m_solver.add(v++);
+    m_solver.add(0);
+  }
+};
+#endif
@@ -43,7 +43,7 @@ public:
   void dump(std::ostream &out) const;
 
 public:
-  void addParameter(std::string const& param) {
+  void addParameter(Symbol const& param) {
     m_params.emplace_back(param);
   }
   unsigned countParameters() const {
@@ -57,7 +57,7 @@ public:
   }
   
   void addPort(PortDecl::Direction        const  dir,
-	       std::string                const& name,
+	       Symbol                     const& name,
 	       std::shared_ptr<Expression const> width) {
     m_ports.emplace_back(dir, name, width);
   }
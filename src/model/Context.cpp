@@ -107,6 +107,7 @@ namespace {
       m_val = m_ctx.resolveBus(expr.name());
     }
     void visit(UniExpression const &expr) override {
+      expr.arg().accept(*this);
       switch(expr.op()) {
       case UniExpression::Op::NOT:
 	m_val = ~m_val;
@@ -122,56 +123,100 @@ namespace {
       expr.rhs().accept(*this);
       Bus const  rhs = m_val;
 
-      std::function<void(Node, Node, Node)>  op;
+      std::function<Node(Node, Node)>  op;
       switch(expr.op()) {
       case BiExpression::Op::AND:
-	op = [this](Node y, Node a, Node b) {
-	  m_ctx.addClause(y, -a, -b);
-	  m_ctx.addClause(-y, a);
-	  m_ctx.addClause(-y, b);
-	};
+	op = [this](Node a, Node b) { return  m_ctx.gateAnd(a, b); };
 	break;
 
       case BiExpression::Op::OR:
-	op = [this](Node y, Node a, Node b) {
-	  m_ctx.addClause(-y, a, b);
-	  m_ctx.addClause(y, -a);
-	  m_ctx.addClause(y, -b);
-	};
+	op = [this](Node a, Node b) { return  m_ctx.gateOr(a, b); };
 	break;
 
       case BiExpression::Op::XOR:
-	op = [this](Node y, Node a, Node b) {
-	  m_ctx.addClause(-y, -a, -b);
-	  m_ctx.addClause(-y,  a,  b);
-	  m_ctx.addClause( y, -a,  b);
-	  m_ctx.addClause( y,  a, -b);
-	};
+	op = [this](Node a, Node b) { return  m_ctx.gateXor(a, b); };
 	break;
 
       case BiExpression::Op::SEL: {
-	m_val = m_ctx.allocateSignal(1);
-	Node     const  y = m_val[0];
 	unsigned const  range = lhs.width();
 
+	{ // Constant Selector: simple wire
+	  unsigned  idx = 0;
+	  unsigned  i   = rhs.width();
+	  while(i-- > 0) {
+	    int const  v = rhs[i];
+	    if((v != Node::TOP) && (v != Node::BOT))  break;
+	    idx = (idx << 1) | (v == Node::TOP? 1 : 0);
+	  }
+	  if(i == ~0u) {
+	    if(idx < range)  m_val = Bus::build(1, [&lhs, idx](unsigned) { return  lhs[idx]; });
+	    else {
+	      // Selection beyond the index range of lhs
+	      m_ctx.addClause(nullptr, nullptr);
+	      m_val = Bus(0, 1);
+	    }
+	    return;
+	  }
+	}
+
 	unsigned  width = 0;
 	for(unsigned  r = range-1; r != 0; r >>= 1)  width++;
-	std::unique_ptr<int[]>  clause(new int[width + 2]);
 
-	// Select appropriate wire from lhs
-	for(unsigned  line = 0; line < range; line++) {
-	  for(unsigned  i = width; i-- > 0;) {
-	    clause[i] = (line & (1<<i)) != 0? -rhs[i] : (unsigned)rhs[i];
+	// The address bits of config tables are not recorded as uses
+	std::unique_ptr<Root::Mute> const  mute(m_ctx.root().readTable(lhs, rhs)? new Root::Mute(m_ctx.root()) : nullptr);
+	switch(m_ctx.multiplex()) {
+	case Root::Multiplex::TREE: {
+	  // Reduce lines pairwise by one selector bit after the other,
+	  //   padding with the last line beyond the index range
+	  std::vector<Node>  level(1u << width);
+	  for(unsigned  line = 0; line < level.size(); line++) {
+	    level[line] = lhs[std::min(line, range-1)];
+	  }
+	  for(unsigned  i = 0; i < width; i++) {
+	    unsigned const  n = level.size() / 2;
+	    for(unsigned  j = 0; j < n; j++)  level[j] = m_ctx.gateMux(rhs[i], level[2*j+1], level[2*j]);
+	    level.resize(n);
+	  }
+	  m_val = Bus::build(1, [&level](unsigned) { return  level[0]; });
+	  break;
+	}
+
+	case Root::Multiplex::DECODER: {
+	  m_val = m_ctx.allocateSignal(1);
+	  Node const  y = m_val[0];
+
+	  // Connect the line of the active minterm
+	  std::vector<int> const &terms = m_ctx.decode(rhs, width);
+	  for(unsigned  line = 0; line < range; line++) {
+	    m_ctx.addClause(-terms[line], -lhs[line],  y);
+	    m_ctx.addClause(-terms[line],  lhs[line], -y);
+	  }
+	  break;
+	}
+
+	case Root::Multiplex::CLAUSES: {
+	  m_val = m_ctx.allocateSignal(1);
+	  Node const  y = m_val[0];
+
+	  // Select appropriate wire from lhs
+	  std::unique_ptr<int[]>  clause(new int[width + 2]);
+	  for(unsigned  line = 0; line < range; line++) {
+	    for(unsigned  i = width; i-- > 0;) {
+	      clause[i] = (line & (1<<i)) != 0? -rhs[i] : (unsigned)rhs[i];
+	    }
+	    clause[width]   =  lhs[line];
+	    clause[width+1] = -y;
+	    m_ctx.addClause(clause.get(), clause.get()+width+2);
+	    clause[width]   = -lhs[line];
+	    clause[width+1] =  y;
+	    m_ctx.addClause(clause.get(), clause.get()+width+2);
 	  }
-	  clause[width]   =  lhs[line];
-	  clause[width+1] = -y;
-	  m_ctx.addClause(clause.get(), clause.get()+width+2);
-	  clause[width]   = -lhs[line];
-	  clause[width+1] =  y;
-	  m_ctx.addClause(clause.get(), clause.get()+width+2);
+	  break;
+	}
 	}
 
 	// Disallow rhs selector values beyond the index range of lhs
+	std::unique_ptr<int[]>  clause(new int[width]);
 	for(unsigned  line = range; line < (1u << width); line++) {
 	  for(unsigned  i = 0; i < width; i++) {
 	    clause[i] = (line & (1<<i)) != 0? -rhs[i] : (unsigned)rhs[i];
@@ -196,9 +241,8 @@ namespace {
 	throw "Unsupported Operation: " + out.str();
       }
 
-      Bus const  res = m_ctx.allocateSignal(std::max(lhs.width(), rhs.width()));
-      for(unsigned  i = res.width(); i-- > 0;) 	op(res[i], lhs[i], rhs[i]);
-      m_val = res;
+      unsigned const  width = std::max(lhs.width(), rhs.width());
+      m_val = Bus::build(width, [&](unsigned const  i) { return  op(lhs[i], rhs[i]); }, true);
       return;
     }
     void visit(CondExpression const &expr) override {
@@ -209,14 +253,8 @@ namespace {
       expr.neg().accept(*this);
       Bus const  neg  = m_val;
 
-      Bus const  res = m_ctx.allocateSignal(std::max(std::max(cond.width(), pos.width()), neg.width()));
-      for(unsigned  i = res.width(); i-- > 0;) {
-	m_ctx.addClause(-cond[i], -pos[i],  res[i]);
-	m_ctx.addClause(-cond[i],  pos[i], -res[i]);
-	m_ctx.addClause( cond[i], -neg[i],  res[i]);
-	m_ctx.addClause( cond[i],  neg[i], -res[i]);
-      }
-      m_val = res;
+      unsigned const  width = std::max(std::max(cond.width(), pos.width()), neg.width());
+      m_val = Bus::build(width, [&](unsigned const  i) { return  m_ctx.gateMux(cond[i], pos[i], neg[i]); }, true);
     }
     void visit(RangeExpression const &expr) override {
       Computer  comp(m_ctx);
@@ -229,10 +267,9 @@ namespace {
       m_val = m_val(lo, hi);
     }
     void visit(ChooseExpression const &expr) override {
-      auto const  generate_name = [](unsigned const  k) {
-	static unsigned  next_id = 0;
+      auto const  generate_name = [this](unsigned const  k) {
 	std::stringstream  s;
-	s << "CHOOSE<" << k << ">/" << next_id++;
+	s << "CHOOSE<" << k << ">/" << m_ctx.nextIndex();
 	return  s.str();
       };
 
@@ -244,6 +281,33 @@ namespace {
       Bus      const  from = m_val;
       unsigned const  n = from.width();
       if(k >= n)  m_val = (Bus(0, k-n), from);
+      else if(m_ctx.selection() == Root::Selection::ORDERED) {
+	// Output j selects from[j+d_j] with 0 <= d_0 <= d_1 <= ... <= n-k.
+	//   Each offset is order-encoded by m-1 config bits: t_j(v) = (d_j >= v)
+	unsigned const  m   = n-k+1;
+	Bus      const  res = m_ctx.allocateSignal(k);
+	Bus      const  cfg = m_ctx.allocateConfig(k*(m-1));
+	m_ctx.registerConfig(generate_name(k), cfg);
+
+	for(unsigned  j = 0; j < k; j++) {
+	  auto const  t = [&cfg, m](unsigned const  j, unsigned const  v) -> int {
+	    return  v == 0? Node::TOP : v == m? Node::BOT : (int)cfg[j*(m-1) + v-1];
+	  };
+
+	  // Output Clauses for all Offsets
+	  for(unsigned  v = 0; v < m; v++) {
+	    m_ctx.addClause(-t(j, v), t(j, v+1), -res[j],  from[j+v]);
+	    m_ctx.addClause(-t(j, v), t(j, v+1),  res[j], -from[j+v]);
+	  }
+
+	  // Consistent Order Encoding and Ascending Offsets
+	  for(unsigned  v = 1; v < m-1; v++)  m_ctx.addClause(-t(j, v+1), t(j, v));
+	  if(j > 0) {
+	    for(unsigned  v = 1; v < m; v++)  m_ctx.addClause(-t(j-1, v), t(j, v));
+	  }
+	}
+	m_val = res;
+      }
       else {
 	Bus  const  res = m_ctx.allocateSignal(k);
 
@@ -303,15 +367,15 @@ namespace {
   }; // class Builder
 }
 
-void Context::defineConstant(std::string const &name, int val) {
-  if(!m_constants.emplace(name, val).second) {
-    throw "Constant " + name + " already defined.";
+void Context::defineConstant(Symbol const &name, int val) {
+  if(!m_constants.emplace(name, val)) {
+    throw "Constant " + name.str() + " already defined.";
   }
 }
-int Context::resolveConstant(std::string const &name) const {
-  auto const  it = m_constants.find(name);
-  if(it != m_constants.end())  return  it->second;
-  throw  m_scope.name() + ": \"" + name + "\" is not defined.";
+int Context::resolveConstant(Symbol const &name) const {
+  int const *const  val = m_constants.find(name);
+  if(val)  return *val;
+  throw  m_scope.name() + ": \"" + name.str() + "\" is not defined.";
 }
 int Context::computeConstant(Expression const &expr) const {
   Computer  comp(*this);
@@ -319,20 +383,47 @@ int Context::computeConstant(Expression const &expr) const {
   return  comp.m_val;
 }
 
-void Context::registerConfig(std::string const &name, Bus const &bus) {
+void Context::registerConfig(Symbol const &name, Bus const &bus) {
   registerSignal(name, bus);
-  m_scope.addConfig(name, bus);
+  m_scope.addConfig(name.str(), bus);
 }
-void Context::registerSignal(std::string const &name, Bus const &bus) {
-  if(!m_busses.emplace(name, bus).second) {
-    throw "Bus " + name + " already defined.";
+void Context::registerSignal(Symbol const &name, Bus const &bus) {
+  if(!m_busses.emplace(name, bus)) {
+    throw "Bus " + name.str() + " already defined.";
   }
 }
 
-Bus Context::resolveBus(std::string const &name) const {
+int const* Context::findConstant(Symbol const &name) const {
+  return  m_constants.find(name);
+}
+
+Root::Multiplex Context::multiplex() const {
+  static Symbol const  SEL_ENCODING("SEL_ENCODING");
+  int const *const  val = findConstant(SEL_ENCODING);
+  if(!val)  return  m_root.multiplex();
+  switch(*val) {
+  case 0: return  Root::Multiplex::CLAUSES;
+  case 1: return  Root::Multiplex::TREE;
+  case 2: return  Root::Multiplex::DECODER;
+  }
+  throw  m_scope.name() + ": Unsupported SEL_ENCODING.";
+}
+
+Root::Selection Context::selection() const {
+  static Symbol const  CHOOSE_ENCODING("CHOOSE_ENCODING");
+  int const *const  val = findConstant(CHOOSE_ENCODING);
+  if(!val)  return  m_root.selection();
+  switch(*val) {
+  case 0: return  Root::Selection::ENUMERATE;
+  case 1: return  Root::Selection::ORDERED;
+  }
+  throw  m_scope.name() + ": Unsupported CHOOSE_ENCODING.";
+}
+
+Bus Context::resolveBus(Symbol const &name) const {
   { // Name of physical bus?
-    auto const  it = m_busses.find(name);
-    if(it != m_busses.end())  return  it->second;
+    Bus const *const  bus = m_busses.find(name);
+    if(bus)  return *bus;
   }
   // Try a constant ...
   return  Bus(resolveConstant(name));
@@ -344,19 +435,24 @@ Bus Context::computeBus(Expression const &expr) {
   return  bld.m_val;
 }
 
-int InnerContext::resolveConstant(std::string const &name) const {
-  auto const  it = m_constants.find(name);
-  return (it != m_constants.end())? it->second : m_parent.resolveConstant(name);
+int InnerContext::resolveConstant(Symbol const &name) const {
+  int const *const  val = m_constants.find(name);
+  return  val? *val : m_parent.resolveConstant(name);
+}
+
+int const* InnerContext::findConstant(Symbol const &name) const {
+  int const *const  val = m_constants.find(name);
+  return  val? val : m_parent.findConstant(name);
 }
 
-Bus InnerContext::resolveBus(std::string const &name) const {
+Bus InnerContext::resolveBus(Symbol const &name) const {
   { // Local name of physical bus?
-    auto const  it = m_busses.find(name);
-    if(it != m_busses.end())  return  it->second;
+    Bus const *const  bus = m_busses.find(name);
+    if(bus)  return *bus;
   }
   { // Try a local constant ...
-    auto const  it = m_constants.find(name);
-    if(it != m_constants.end())  return  it->second;
+    int const *const  val = m_constants.find(name);
+    if(val)  return *val;
   }
   return  m_parent.resolveBus(name);
 }
@@ -24,7 +24,9 @@
 #include "Root.hpp"
 #include "CompDecl.hpp"
 #include "Statement.hpp"
+#include "Symbol.hpp"
 
+#include <array>
 #include <map>
 
 class Expression;
@@ -35,34 +37,86 @@ class Context {
   unsigned  m_subcnt;
 
 protected:
-  std::map<std::string, int>  m_constants;
-  std::map<std::string, Bus>  m_busses;
+  SymbolMap<int>  m_constants;
+  SymbolMap<Bus>  m_busses;
 
 public:
   Context(Context const&) = delete;
   Context(Root &root, Scope &scope)
     : m_root(root), m_scope(scope), m_subcnt(0) {}
-  Context(Root &root, Scope &scope, std::map<std::string, int> &&constants)
-    : m_root(root), m_scope(scope), m_subcnt(0), m_constants(constants) {}
+  Context(Root &root, Scope &scope, SymbolMap<int> &&constants)
+    : m_root(root), m_scope(scope), m_subcnt(0), m_constants(std::move(constants)) {}
 
   Context(Context &parent, std::string const &name,
-	  std::map<std::string, int> &&constants,
-	  std::map<std::string, Bus> &&busses)
+	  SymbolMap<int> &&constants,
+	  SymbolMap<Bus> &&busses)
     : m_root(parent.root()), m_scope(parent.scope().createChild(name)), m_subcnt(0),
-      m_constants(constants), m_busses(busses) {}
+      m_constants(std::move(constants)), m_busses(std::move(busses)) {}
   ~Context() {}
 
 public:
   Root&  root()  { return  m_root; }
   Scope& scope() { return  m_scope; }
 
+  /** Numbers the anonymous children of the scope deterministically. */
+  unsigned nextIndex() { return  m_subcnt++; }
+
+  // The operations are traced for the templates being recorded
 public:
-  Bus allocateConfig(unsigned  width) { return  m_root.allocateConfig(width); }
+  Bus allocateConfig(unsigned  width) {
+    m_root.trace(Template::Op::CONFIG, {(int)width});
+    return  m_root.traced(m_root.allocateConfig(width));
+  }
   Bus allocateInput (unsigned  width) { return  m_root.allocateInput (width); }
-  Bus allocateSignal(unsigned  width) { return  m_root.allocateSignal(width); }
+  Bus allocateSignal(unsigned  width) {
+    m_root.trace(Template::Op::SIGNAL, {(int)width});
+    return  m_root.traced(m_root.allocateSignal(width));
+  }
 
 public:
-  void addClause(int const *beg, int const *end) { m_root.addClause(beg, end); }
+  Node gateAnd(Node  a, Node  b) {
+    m_root.trace(Template::Op::AND, {a, b});
+    return  m_root.traced(m_root.gateAnd(a, b));
+  }
+  Node gateOr (Node  a, Node  b) { return -gateAnd(-a, -b); }
+  Node gateXor(Node  a, Node  b) {
+    m_root.trace(Template::Op::XOR, {a, b});
+    return  m_root.traced(m_root.gateXor(a, b));
+  }
+  Node gateMux(Node  s, Node  a, Node  b) {
+    m_root.trace(Template::Op::MUX, {s, a, b});
+    return  m_root.traced(m_root.gateMux(s, a, b));
+  }
+  void equate (Node  a, Node  b) {
+    m_root.trace(Template::Op::EQUATE, {a, b});
+    m_root.equate(a, b);
+  }
+  std::vector<int> const& decode(Bus const &sel, unsigned  width) {
+    std::vector<int>  bits;
+    for(unsigned  i = 0; i < width; i++)  bits.push_back(sel[i]);
+    m_root.trace(Template::Op::DECODE, bits.data(), bits.data()+width);
+    return  m_root.traced(m_root.decode(sel, width));
+  }
+
+  /**
+   * Returns the encoding of SEL operations within this context, which
+   * may be chosen by the constant SEL_ENCODING: 0 - clauses, 1 - tree,
+   * 2 - decoder. The global default applies otherwise.
+   */
+  Root::Multiplex multiplex() const;
+
+  /**
+   * Returns the encoding of CHOOSE operations within this context, which
+   * may be chosen by the constant CHOOSE_ENCODING: 0 - enumerate,
+   * 1 - ordered. The global default applies otherwise.
+   */
+  Root::Selection selection() const;
+
+public:
+  void addClause(int const *beg, int const *end) {
+    m_root.trace(Template::Op::CLAUSE, beg, end);
+    m_root.addClause(beg, end);
+  }
   void addClause(int a) {
     std::array<int const, 1>  clause{a};
     addClause(clause.begin(), clause.end());
@@ -75,22 +129,27 @@ public:
     std::array<int const, 3>  clause{a, b, c};
     addClause(clause.begin(), clause.end());
   }
+  void addClause(int a, int b, int c, int d) {
+    std::array<int const, 4>  clause{a, b, c, d};
+    addClause(clause.begin(), clause.end());
+  }
 
 public:
   void compile(std::string const &name, CompDecl const &comp) {
-    std::cout << "Compiling " << name << " : " << comp.name() << " ..." << std::endl;
+    if(m_root.verbose())  std::cout << "Compiling " << name << " : " << comp.name() << " ..." << std::endl;
     comp.forAllStatements([this](Statement const &stmt) { stmt.execute(*this); });
   }
 
 public:
-  void defineConstant(std::string const &name, int val);
+  void defineConstant(Symbol const &name, int val);
   int computeConstant(Expression  const &name) const;
-  virtual int resolveConstant(std::string const &name) const;
+  virtual int resolveConstant(Symbol const &name) const;
+  virtual int const* findConstant(Symbol const &name) const;
 
-  void registerConfig(std::string const &name, Bus const &bus);
-  void registerSignal(std::string const &name, Bus const &bus);
+  void registerConfig(Symbol const &name, Bus const &bus);
+  void registerSignal(Symbol const &name, Bus const &bus);
   Bus computeBus(Expression  const &name);
-  virtual Bus resolveBus(std::string const &name) const;
+  virtual Bus resolveBus(Symbol const &name) const;
 };
 
 class InnerContext : public Context {
@@ -102,7 +161,8 @@ public:
   ~InnerContext() {}
 
 public:
-  virtual int resolveConstant(std::string const &name) const;
-  virtual Bus resolveBus(std::string const &name) const;
+  virtual int resolveConstant(Symbol const &name) const;
+  virtual int const* findConstant(Symbol const &name) const;
+  virtual Bus resolveBus(Symbol const &name) const;
 };
 #endif
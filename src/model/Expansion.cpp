@@ -0,0 +1,181 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "Expansion.hpp"
+#include "Ipasir.hpp"
+
+#include <thread>
+#include <limits>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace qbm;
+
+char const* Expansion::version() const {
+  return  "Expansion";
+}
+char const* Expansion::backend() const {
+  return  m_lib.signature();
+}
+
+bool Expansion::expandable() const {
+  unsigned long const  nc = std::count(m_kinds.begin(), m_kinds.end(), Kind::CONFIG);
+  unsigned long const  ni = std::count(m_kinds.begin(), m_kinds.end(), Kind::INPUT);
+  unsigned long const  ns = m_kinds.size()-1 - nc - ni;
+  return (ni <= MAX_INPUTS) && (nc + (1ul << ni)*ns <= (unsigned long)std::numeric_limits<int>::max());
+}
+
+std::vector<std::vector<int>> Expansion::expand(unsigned long &vars) const {
+  unsigned const  nv = m_kinds.size()-1;
+
+  // Dense numbering within the variable kinds
+  std::vector<unsigned>  index(nv+1);
+  unsigned  nc = 0;
+  unsigned  ni = 0;
+  unsigned  ns = 0;
+  for(unsigned  v = 1; v <= nv; v++) {
+    switch(m_kinds[v]) {
+    case Kind::CONFIG: index[v] = ++nc; break;
+    case Kind::INPUT:  index[v] = ni++; break;
+    default:           index[v] = ns++; break;
+    }
+  }
+  if(ni > MAX_INPUTS)  throw "Too many inputs for expansion.";
+
+  unsigned long const  copies = 1ul << ni;
+  if(nc + copies*ns > (unsigned long)std::numeric_limits<int>::max()) {
+    throw "Too many variables for expansion.";
+  }
+  vars = nc + copies*ns;
+
+  // Distribute the input vectors evenly over the shards
+  unsigned const  threads = std::max(1ul, std::min<unsigned long>(std::thread::hardware_concurrency(), copies));
+  std::vector<std::vector<int>>  shards(threads);
+  auto const  build = [&](unsigned const  t) {
+    std::vector<int> &out = shards[t];
+    unsigned long const  lo = copies *  t    / threads;
+    unsigned long const  hi = copies * (t+1) / threads;
+    for(unsigned long  k = lo; (k < hi) && !interrupted(); k++) {
+      int const  base = nc + k*ns + 1;
+
+      auto  it = m_clauses.begin();
+      while(it != m_clauses.end()) {
+	size_t const  size   = out.size();
+	bool          sat    = false;
+	bool          shared = true;  // clause only over configs
+	for(int  lit; (lit = *it++) != 0;) {
+	  unsigned const  v = std::abs(lit);
+	  switch(m_kinds[v]) {
+	  case Kind::CONFIG:
+	    out.push_back(lit > 0? (int)index[v] : -(int)index[v]);
+	    break;
+	  case Kind::INPUT:
+	    if((((k >> index[v]) & 1) != 0) == (lit > 0))  sat = true;
+	    shared = false;
+	    break;
+	  default:
+	    out.push_back(lit > 0? base + (int)index[v] : -(base + (int)index[v]));
+	    shared = false;
+	    break;
+	  }
+	}
+	// Satisfied clauses are dropped, shared ones are only kept once
+	if(sat || (shared && (k != 0)))  out.resize(size);
+	else  out.push_back(0);
+      }
+    }
+  };
+
+  std::vector<std::thread>  workers;
+  for(unsigned  t = 1; t < threads; t++)  workers.emplace_back(build, t);
+  build(0);
+  for(std::thread &w : workers)  w.join();
+  return  shards;
+}
+
+Result Expansion::sat() {
+  // Never throw here: the solution may be running in a detached thread
+  if(!expandable())  return  QUANTOR_RESULT_SPACEOUT;
+  std::vector<int> const  assumptions(std::move(m_assumptions));
+  m_assumptions.clear();
+
+  if(!m_solver) {
+    std::unique_ptr<Ipasir>  solver(new Ipasir(m_lib));
+    unsigned long  vars;
+    terminate(*solver);
+    for(std::vector<int> &shard : expand(vars)) {
+      for(int  lit : shard)  solver->add(lit);
+      std::vector<int>().swap(shard);
+    }
+    if(interrupted())  return  QUANTOR_RESULT_UNKNOWN;
+    m_solver = std::move(solver);
+  }
+  Ipasir &solver = *m_solver;
+
+  // Configs are constrained and assumed by their dense number
+  std::vector<int>  index(m_kinds.size(), 0);
+  {
+    int  nc = 0;
+    for(unsigned  v = 1; v < m_kinds.size(); v++) {
+      if(m_kinds[v] == Kind::CONFIG)  index[v] = ++nc;
+    }
+  }
+  auto const  dense = [&index](int const  lit) {
+    return  lit > 0? index[lit] : -index[-lit];
+  };
+  for(int  lit : m_constraints)  solver.add(dense(lit));
+  m_constraints.clear();
+  for(int  lit : assumptions)  solver.assume(dense(lit));
+
+  if(interrupted())  return  QUANTOR_RESULT_UNKNOWN;
+  switch(solver.solve()) {
+  case 10:
+    break;
+  case 20:
+    return  QUANTOR_RESULT_UNSATISFIABLE;
+  default:
+    return  QUANTOR_RESULT_UNKNOWN;
+  }
+
+  // Configs are numbered densely from 1 in the expanded instance
+  int  idx = 0;
+  m_assignment.clear();
+  for(int  v = 1; v < (int)m_kinds.size(); v++) {
+    if(m_kinds[v] == Kind::CONFIG)  m_assignment.push_back(solver.val(++idx) > 0? v : -v);
+  }
+  m_assignment.push_back(0);
+  return  QUANTOR_RESULT_SATISFIABLE;
+}
+
+void Expansion::dump(std::ostream &out) const {
+  unsigned long                        vars;
+  std::vector<std::vector<int>> const  shards = expand(vars);
+
+  unsigned long  clauses = 0;
+  for(auto const &shard : shards)  clauses += std::count(shard.begin(), shard.end(), 0);
+
+  out << "p cnf " << vars << ' ' << clauses << '\n';
+  for(auto const &shard : shards) {
+    for(int  lit : shard) {
+      if(lit)  out << lit << ' ';
+      else     out << "0\n";
+    }
+  }
+  out.flush();
+}
@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef EXPANSION_HPP
+#define EXPANSION_HPP
+
+#include "Formula.hpp"
+#include "Ipasir.hpp"
+
+#include <memory>
+#include <ostream>
+
+namespace qbm {
+/**
+ * This class solves the quantified formulas collected by a Formula by
+ * their complete universal expansion into a plain SAT instance. Each
+ * assignment to the inputs contributes one copy of the matrix over its own
+ * signal variables while all copies share the configuration variables.
+ * The copies are built concurrently in several shards of input vectors.
+ *
+ * The configuration variables are numbered densely from 1 in the expanded
+ * instance. They are followed by the signal variables of one copy after
+ * the other.
+ *
+ * The expanded instance persists across sat() calls under different
+ * assumptions so that its learned clauses are reused.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class Expansion : public Formula {
+  IpasirLib const          m_lib;     // SAT solver backend
+  std::unique_ptr<Ipasir>  m_solver;  // expanded instance
+
+public:
+  /** The maximum number of inputs accepted for expansion. */
+  static unsigned const  MAX_INPUTS = 24;
+
+  //- Construction / Destruction
+public:
+  Expansion(IpasirLib const &lib = IpasirLib()) : m_lib(lib) {}
+  ~Expansion() {}
+
+  //- Information
+public:
+  char const* version() const;
+  char const* backend() const;
+
+  //- Solving / Output
+public:
+  Result sat();
+  void dump(std::ostream &out) const;
+
+private:
+  /**
+   * Whether the expanded instance stays within MAX_INPUTS and the range of
+   * the variables of the SAT solver.
+   */
+  bool expandable() const;
+
+  /**
+   * Builds the clauses of all matrix copies in shards of input vectors.
+   * @param vars receives the number of variables of the expanded instance
+   */
+  std::vector<std::vector<int>> expand(unsigned long &vars) const;
+};
+}
+#endif
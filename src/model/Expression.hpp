@@ -20,8 +20,11 @@
 #ifndef EXPRESSION_HPP
 #define EXPRESSION_HPP
 
+#include "Symbol.hpp"
+
 #include <string>
 #include <iostream>
+#include <array>
 #include <memory>
 
 class ConstExpression;
@@ -71,14 +74,14 @@ public:
 };
 
 class NameExpression : public Expression {
-  std::string const  m_name;
+  Symbol const  m_name;
 
 public:
-  NameExpression(std::string const &name) : m_name(name) {}
+  NameExpression(Symbol const &name) : m_name(name) {}
   ~NameExpression();
 
 public:
-  std::string const& name() const { return  m_name; }
+  Symbol const& name() const { return  m_name; }
 
 public:
   void accept(Visitor &vis) const;
@@ -0,0 +1,224 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "External.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+
+using namespace qbm;
+
+/**
+ * Output buffer writing to a socket. A socket is used for the standard
+ * input of the solver so that a solver exiting early is noticed as an
+ * error upon sending rather than raising SIGPIPE.
+ */
+class External::Channel : public std::streambuf {
+  int   m_fd;
+  char  m_buf[1<<16];
+
+public:
+  Channel(int const  fd) : m_fd(fd) {
+    setp(m_buf, m_buf + sizeof(m_buf));
+  }
+  ~Channel() { close(); }
+
+public:
+  void close() {
+    if(m_fd >= 0) {
+      sync();
+      ::close(m_fd);
+      m_fd = -1;
+    }
+  }
+
+protected:
+  int overflow(int const  c) override {
+    if(sync() != 0)  return  traits_type::eof();
+    if(c != traits_type::eof()) {
+      *pptr() = c;
+      pbump(1);
+    }
+    return  traits_type::not_eof(c);
+  }
+
+  int sync() override {
+    char const *beg = pbase();
+    char const *const  end = pptr();
+    while(beg < end) {
+      ssize_t const  n = ::send(m_fd, beg, end-beg, MSG_NOSIGNAL);
+      if(n < 0) {
+	if(errno == EINTR)  continue;
+	setp(m_buf, m_buf); // solver is gone: stop buffering
+	return -1;
+      }
+      beg += n;
+    }
+    setp(m_buf, m_buf + sizeof(m_buf));
+    return  0;
+  }
+};
+
+External::External(std::string const &command)
+  : m_command(command), m_configs(0), m_pid(0), m_interrupted(false),
+    m_out(nullptr), m_writer(m_out) {
+
+  int  in[2];
+  int  out[2];
+  if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, in) < 0) {
+    throw  std::string("Cannot create solver input: ") + strerror(errno);
+  }
+  if(pipe2(out, O_CLOEXEC) < 0) {
+    int const  err = errno;
+    ::close(in[0]);
+    ::close(in[1]);
+    throw  std::string("Cannot create solver output: ") + strerror(err);
+  }
+
+  m_pid = fork();
+  if(m_pid == 0) {
+    // Child in its own process group to take along subprocesses of the shell
+    setpgid(0, 0);
+    dup2(in[1],  STDIN_FILENO);
+    dup2(out[1], STDOUT_FILENO);
+    execl("/bin/sh", "sh", "-c", command.c_str(), (char*)nullptr);
+    _exit(127);
+  }
+  int const  err = errno;
+  ::close(in[1]);
+  ::close(out[1]);
+  if(m_pid < 0) {
+    m_pid = 0;
+    ::close(in[0]);
+    ::close(out[0]);
+    throw  std::string("Cannot start solver '") + command + "': " + strerror(err);
+  }
+  setpgid(m_pid, m_pid);
+
+  // Stream the formula into the solver while collecting its output
+  int const  fd = out[0];
+  m_channel.reset(new Channel(in[0]));
+  m_out.rdbuf(m_channel.get());
+  m_reader = std::thread([this, fd]() {
+      char  buf[4096];
+      while(true) {
+	ssize_t const  n = ::read(fd, buf, sizeof(buf));
+	if(n > 0)  m_output.append(buf, n);
+	else if((n == 0) || (errno != EINTR))  break;
+      }
+      ::close(fd);
+    });
+}
+
+External::~External() {
+  if(m_pid) {
+    interrupt();
+    m_channel->close();
+    if(m_reader.joinable())  m_reader.join();
+    reap();
+  }
+}
+
+void External::prefix(unsigned  configs, unsigned  inputs, unsigned  signals, unsigned long  clauses) {
+  m_configs = configs;
+  m_writer.prefix(configs, inputs, signals, clauses);
+}
+
+void External::clause(int const *beg, int const *end) {
+  m_writer.clause(beg, end);
+}
+
+void External::interrupt() {
+  std::lock_guard<std::mutex>  lock(m_mtx);
+  m_interrupted = true;
+  if(m_pid)  kill(-m_pid, SIGKILL);
+}
+
+int External::reap() {
+  // Wait without reaping so that interrupt() never signals a recycled pid
+  siginfo_t  info;
+  while((waitid(P_PID, m_pid, &info, WEXITED | WNOWAIT) < 0) && (errno == EINTR));
+
+  std::lock_guard<std::mutex>  lock(m_mtx);
+  int  status = 0;
+  while((waitpid(m_pid, &status, 0) < 0) && (errno == EINTR));
+  m_pid = 0;
+  return  status;
+}
+
+Result External::sat() {
+  m_channel->close();
+  m_reader.join();
+  int const  status = reap();
+
+  {
+    std::lock_guard<std::mutex>  lock(m_mtx);
+    if(m_interrupted)  return  QUANTOR_RESULT_UNKNOWN;
+  }
+  if(!WIFEXITED(status))  return  QUANTOR_RESULT_UNKNOWN;
+
+  // Answer of the solver
+  int   answer  = 0;
+  bool  certified = false;
+  std::vector<bool>  config(m_configs, false);
+  {
+    std::istringstream  in(m_output);
+    std::string         line;
+    while(std::getline(in, line)) {
+      std::istringstream  ln(line);
+      std::string         key;
+      ln >> key;
+      if(key == "s") {
+	std::string  fmt;
+	int          val;
+	if((ln >> fmt >> val) && (fmt == "cnf"))  answer = val == 1? 10 : val == 0? 20 : -1;
+      }
+      else if(key == "V") {
+	int  lit;
+	if(ln >> lit) {
+	  unsigned const  v = std::abs(lit);
+	  if((v > 0) && (v <= m_configs)) {
+	    config[v-1] = lit > 0;
+	    certified   = true;
+	  }
+	}
+      }
+    }
+  }
+  if(answer == 0)  answer = WEXITSTATUS(status);
+
+  switch(answer) {
+  case 10:
+    if(!certified && (m_configs > 0))  return  QUANTOR_RESULT_UNKNOWN;
+    m_assignment.clear();
+    for(unsigned  v = 1; v <= m_configs; v++)  m_assignment.push_back(config[v-1]? v : -(int)v);
+    m_assignment.push_back(0);
+    return  QUANTOR_RESULT_SATISFIABLE;
+
+  case 20:
+    return  QUANTOR_RESULT_UNSATISFIABLE;
+  }
+  return  QUANTOR_RESULT_UNKNOWN;
+}
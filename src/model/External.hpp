@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef EXTERNAL_HPP
+#define EXTERNAL_HPP
+
+#include "ClauseSink.hpp"
+#include "Result.hpp"
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ostream>
+#include <sys/types.h>
+
+namespace qbm {
+/**
+ * This class runs an external QBF solver as a child process. The command
+ * is executed by /bin/sh. The formula is streamed into the standard input
+ * of the solver in the QDIMACS format as it is received so that the solver
+ * may parse it concurrently. The solver answer is taken from its QDIMACS
+ * output:
+ *   s cnf <1|0|-1> ...   - result, alternatively the exit code 10 or 20
+ *   V <lit> 0            - certificate of the outermost existentials
+ * Configuration variables without a certificate line are assigned false.
+ * A satisfiable answer lacking any certificate line is reported as
+ * unknown as the configuration cannot be reconstructed.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class External : public ClauseSink {
+  class Channel;
+
+  std::string const         m_command;
+  unsigned                  m_configs;
+  std::mutex                m_mtx;          // guards the child pid
+  pid_t                     m_pid;          // 0 once reaped
+  bool                      m_interrupted;
+  std::unique_ptr<Channel>  m_channel;      // to standard input of solver
+  std::ostream              m_out;          // buffered through m_channel
+  QDimacsWriter             m_writer;
+  std::thread               m_reader;       // collecting standard output
+  std::string               m_output;
+  std::vector<int>          m_assignment;   // zero-terminated config assignment
+
+  //- Construction / Destruction
+public:
+  /**
+   * Starts the solver process.
+   * @throws std::string if the process cannot be created
+   */
+  External(std::string const &command);
+  External(External const&) = delete;
+  ~External();
+
+  //- Information
+public:
+  char const* version() const { return  "External"; }
+  char const* backend() const { return  m_command.c_str(); }
+
+  //- Formula Reception
+public:
+  void prefix(unsigned  configs, unsigned  inputs, unsigned  signals, unsigned long  clauses) override;
+  void clause(int const *beg, int const *end) override;
+
+  //- Solving / Result Retrieval
+public:
+  /** Terminates the solver process so that a running sat() returns unknown. */
+  void interrupt();
+
+  /** Completes the formula and awaits the answer of the solver. */
+  Result sat();
+  int const* assignment() const {
+    return  m_assignment.data();
+  }
+
+private:
+  /** Waits for the termination of the solver and returns its exit status. */
+  int reap();
+};
+}
+#endif
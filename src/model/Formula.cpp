@@ -0,0 +1,60 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "Formula.hpp"
+
+#include <cstdlib>
+
+using namespace qbm;
+
+char const* Formula::scope(::QuantorQuantificationType const  quant) {
+  Kind  next = Kind::NONE;
+  switch(m_scope) {
+  case Kind::NONE:
+    if(quant == QUANTOR_EXISTENTIAL_VARIABLE_TYPE)  next = Kind::CONFIG;
+    break;
+  case Kind::CONFIG:
+    if(quant == QUANTOR_UNIVERSAL_VARIABLE_TYPE)    next = Kind::INPUT;
+    break;
+  case Kind::INPUT:
+    if(quant == QUANTOR_EXISTENTIAL_VARIABLE_TYPE)  next = Kind::SIGNAL;
+    break;
+  case Kind::SIGNAL:
+    break;
+  }
+  if(next == Kind::NONE)  return  "Unsupported quantifier prefix.";
+
+  m_scope = next;
+  m_open  = true;
+  return  0;
+}
+
+char const* Formula::add(int const  lit) {
+  unsigned const  var = std::abs(lit);
+  if(var >= m_kinds.size())  m_kinds.resize(var+1, Kind::NONE);
+
+  // Collect Scope Members until closed by zero
+  if(m_open) {
+    if(lit == 0)  m_open = false;
+    else          m_kinds[var] = m_scope;
+    return  0;
+  }
+  m_clauses.push_back(lit);
+  return  0;
+}
@@ -0,0 +1,109 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef FORMULA_HPP
+#define FORMULA_HPP
+
+#include "Ipasir.hpp"
+#include "Result.hpp"
+
+#include <atomic>
+#include <vector>
+
+namespace qbm {
+/**
+ * This class collects a quantified formula of the form
+ *   exists config: forall inputs: exists signals: matrix
+ * through the problem construction interface of the Quantor wrapper. It
+ * serves as the base of the solution engines implemented within QBM.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class Formula {
+protected:
+  enum class Kind : unsigned char { NONE, CONFIG, INPUT, SIGNAL };
+
+  Kind               m_scope;       // innermost scope opened so far
+  bool               m_open;        // collecting scope members
+  std::vector<Kind>  m_kinds;       // quantification by variable
+  std::vector<int>   m_clauses;     // zero-terminated clauses
+  std::vector<int>   m_assignment;  // zero-terminated config assignment
+  std::vector<int>   m_assumptions; // config literals for the next sat()
+  std::vector<int>   m_constraints; // zero-terminated config clauses to add
+
+private:
+  std::atomic<bool>  m_interrupted;
+
+  //- Construction / Destruction
+protected:
+  Formula() : m_scope(Kind::NONE), m_open(false), m_kinds(1, Kind::NONE), m_interrupted(false) {}
+  ~Formula() {}
+
+  //- Interruption
+public:
+  /**
+   * Asks a running sat() from another thread to give up with an unknown
+   * result. It is checked between the individual SAT solver calls and
+   * polled by the SAT solvers registered through terminate().
+   */
+  void interrupt() { m_interrupted = true; }
+  /**
+   * Withdraws a previous interrupt() so that the engine takes further
+   * sat() calls, which continue from its retained SAT instances.
+   */
+  void resume() { m_interrupted = false; }
+protected:
+  bool interrupted() const { return  m_interrupted; }
+
+  /** Makes the given SAT solver abort its search upon interrupt(). */
+  void terminate(Ipasir &solver) const {
+    solver.terminate(const_cast<Formula*>(this), [](void *state) -> int {
+	return  static_cast<Formula const*>(state)->interrupted();
+      });
+  }
+
+  //- Problem Construction
+public:
+  char const* scope(::QuantorQuantificationType const  quant);
+  char const* add(int const  lit);
+
+  /**
+   * Assumes the given config literal for the next sat() only, like IPASIR.
+   * The engines keep their SAT instances across sat() calls so that the
+   * same formula can be solved under different assumptions incrementally.
+   */
+  void assume(int const  lit) { m_assumptions.push_back(lit); }
+
+  /**
+   * Adds the clause over the config literals in [beg, end) permanently for
+   * all later sat() calls, e.g. to block a configuration already found.
+   */
+  void constrain(int const *beg, int const *end) {
+    m_constraints.insert(m_constraints.end(), beg, end);
+    m_constraints.push_back(0);
+  }
+
+  //- Result Retrieval
+public:
+  int const* assignment() const {
+    return  m_assignment.data();
+  }
+};
+}
+#endif
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "Ipasir.hpp"
+
+#include <string>
+#include <dlfcn.h>
+
+using namespace qbm;
+
+IpasirLib::IpasirLib()
+  : signature(ipasir_signature), init(ipasir_init), release(ipasir_release),
+    add(ipasir_add), assume(ipasir_assume), solve(ipasir_solve),
+    val(ipasir_val), failed(ipasir_failed), set_terminate(ipasir_set_terminate) {}
+
+namespace {
+  template<typename F>
+  void resolve(void *const  handle, char const *const  path, char const *const  name, F &f) {
+    f = reinterpret_cast<F>(dlsym(handle, name));
+    if(!f)  throw  std::string(path) + ": Missing IPASIR function " + name + '.';
+  }
+}
+
+IpasirLib::IpasirLib(char const *path) {
+  void *const  handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if(!handle)  throw  std::string("Cannot load IPASIR library: ") + dlerror();
+
+  resolve(handle, path, "ipasir_signature",     signature);
+  resolve(handle, path, "ipasir_init",          init);
+  resolve(handle, path, "ipasir_release",       release);
+  resolve(handle, path, "ipasir_add",           add);
+  resolve(handle, path, "ipasir_assume",        assume);
+  resolve(handle, path, "ipasir_solve",         solve);
+  resolve(handle, path, "ipasir_val",           val);
+  resolve(handle, path, "ipasir_failed",        failed);
+  resolve(handle, path, "ipasir_set_terminate", set_terminate);
+}
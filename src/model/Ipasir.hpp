@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef IPASIR_HPP
+#define IPASIR_HPP
+
+extern "C" {
+#  include "ipasir.h"
+}
+
+namespace qbm {
+/**
+ * This class holds the entry points of an IPASIR SAT solver library. It
+ * either refers to the library linked at build time or to one loaded at
+ * runtime so that several solver libraries may coexist in one process.
+ * Loaded libraries are never unloaded as abandoned solver instances may
+ * still be running within them.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class IpasirLib {
+public:
+  char const* (*signature)();
+  void*       (*init)();
+  void        (*release)(void *solver);
+  void        (*add)(void *solver, int lit);
+  void        (*assume)(void *solver, int lit);
+  int         (*solve)(void *solver);
+  int         (*val)(void *solver, int lit);
+  int         (*failed)(void *solver, int lit);
+  void        (*set_terminate)(void *solver, void *state, int (*terminate)(void *state));
+
+  //- Construction / Destruction
+public:
+  /** The IPASIR library linked at build time. */
+  IpasirLib();
+
+  /**
+   * Loads the IPASIR library from the given shared object file.
+   * @throws std::string if the library or one of its entry points cannot be found
+   */
+  explicit IpasirLib(char const *path);
+  ~IpasirLib() {}
+};
+
+/**
+ * This class provides a thin C++ wrapper around an incremental SAT solver
+ * implementing the IPASIR API.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class Ipasir {
+  IpasirLib const  lib;
+  void* const      solver;
+
+  //- Construction / Destruction
+public:
+  Ipasir(IpasirLib const &lib = IpasirLib()) : lib(lib), solver(lib.init()) {}
+  Ipasir(Ipasir const&) = delete;
+  ~Ipasir() { lib.release(solver); }
+
+  //- Information
+public:
+  char const* signature() const {
+    return  lib.signature();
+  }
+
+  //- Problem Construction
+public:
+  void add(int const  lit) {
+    lib.add(solver, lit);
+  }
+  void assume(int const  lit) {
+    lib.assume(solver, lit);
+  }
+
+  //- Solving / Result Retrieval
+public:
+  /**
+   * Installs a callback polled during the search, which aborts solve()
+   * with result 0 when it returns non-zero.
+   */
+  void terminate(void *const  state, int (*const  cb)(void *state)) {
+    lib.set_terminate(solver, state, cb);
+  }
+  int solve() {
+    return  lib.solve(solver);
+  }
+  int val(int const  lit) const {
+    return  lib.val(solver, lit);
+  }
+  bool failed(int const  lit) const {
+    return  lib.failed(solver, lit) != 0;
+  }
+};
+}
+#endif
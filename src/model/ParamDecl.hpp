@@ -21,16 +21,17 @@
 #define PARAMDECL_HPP
 
 #include "Decl.hpp"
+#include "Symbol.hpp"
 
 class ParamDecl : public Decl {
-  std::string const  m_name;
+  Symbol const  m_name;
 
 public:
-  ParamDecl(std::string const &name) : m_name(name) {}
+  ParamDecl(Symbol const &name) : m_name(name) {}
   ~ParamDecl();
 
 public:
-  std::string const& name() const { return  m_name; }
+  Symbol const& name() const { return  m_name; }
   void dump(std::ostream& out) const;
 };
 #endif
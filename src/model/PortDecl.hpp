@@ -30,7 +30,7 @@ private:
 
 public:
   PortDecl(Direction                  const  dir,
-	   std::string                const &name,
+	   Symbol                     const &name,
 	   std::shared_ptr<Expression const> width)
     : WireDecl(name, width), m_dir(dir) {}
   ~PortDecl();
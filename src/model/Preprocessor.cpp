@@ -0,0 +1,486 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "Preprocessor.hpp"
+
+#include <algorithm>
+
+namespace {
+  /** Orders literals by variable, the negative one first. */
+  bool before(int const  a, int const  b) {
+    return  std::abs(a) < std::abs(b) || (std::abs(a) == std::abs(b) && a < b);
+  }
+
+  unsigned long signature(int const *beg, int const *end) {
+    unsigned long  sig = 0;
+    while(beg < end)  sig |= 1ul << (std::abs(*beg++) & 63);
+    return  sig;
+  }
+}
+
+void Preprocessor::prefix(unsigned  configs, unsigned  inputs, unsigned  signals, unsigned long  clauses) {
+  unsigned const  n = configs + inputs + signals;
+  m_configs = configs;
+  m_inputs  = inputs;
+  m_signals = signals;
+  m_clauses.reserve(clauses);
+  m_occs.resize(2*(n+1));
+  m_vals.assign(n+1, 0);
+  m_gone.assign(n+1, false);
+}
+
+void Preprocessor::clause(int const *beg, int const *end) {
+  m_buf.assign(beg, end);
+  insert(m_buf);
+}
+
+void Preprocessor::insert(std::vector<int> &lits) {
+  if(m_conflict)  return;
+
+  // Drop false Literals, skip satisfied and tautological Clauses
+  std::sort(lits.begin(), lits.end(), before);
+  lits.erase(std::unique(lits.begin(), lits.end()), lits.end());
+  unsigned  n = 0;
+  bool      signal = false;
+  for(unsigned  i = 0; i < lits.size(); i++) {
+    int const  lit = lits[i];
+    if((i+1 < lits.size()) && (lits[i+1] == -lit))  return;
+    int const  val = value(lit);
+    if(val > 0)  return;
+    if(val < 0)  continue;
+    if(level(lit) == 2)  signal = true;
+    lits[n++] = lit;
+  }
+  lits.resize(n);
+
+  // Universal Reduction: no signal may depend on the inputs
+  if(!signal) {
+    auto const  last = std::remove_if(lits.begin(), lits.end(), [this](int const  lit) {
+	return  level(lit) == 1;
+      });
+    m_stats.reduced += lits.end() - last;
+    lits.erase(last, lits.end());
+  }
+
+  switch(lits.size()) {
+  case 0:
+    m_conflict = true;
+    return;
+  case 1:
+    assign(lits[0]);
+    return;
+  }
+  unsigned const  id = m_clauses.size();
+  m_clauses.push_back(Clause{ (unsigned)m_lits.size(), (unsigned)lits.size(), false,
+	                      signature(lits.data(), lits.data()+lits.size()) });
+  m_lits.insert(m_lits.end(), lits.begin(), lits.end());
+  for(int  lit : lits)  m_occs[index(lit)].push_back(id);
+}
+
+void Preprocessor::assign(int const  lit) {
+  int const  val = value(lit);
+  if(val > 0)  return;
+  if(val < 0) {
+    m_conflict = true;
+    return;
+  }
+  m_vals[std::abs(lit)] = lit > 0? 1 : -1;
+  m_trail.push_back(lit);
+  m_stats.units++;
+}
+
+void Preprocessor::unlink(unsigned const  id, int const  lit) {
+  std::vector<unsigned> &occs = m_occs[index(lit)];
+  auto const  it = std::find(occs.begin(), occs.end(), id);
+  if(it != occs.end()) {
+    *it = occs.back();
+    occs.pop_back();
+  }
+}
+
+void Preprocessor::strengthen(unsigned const  id, int const  lit) {
+  Clause &c    = m_clauses[id];
+  int    *lits = m_lits.data() + c.beg;
+  c.size = std::remove(lits, lits+c.size, lit) - lits;
+  unlink(id, lit);
+  settle(id);
+}
+
+void Preprocessor::settle(unsigned const  id) {
+  Clause &c    = m_clauses[id];
+  int    *lits = m_lits.data() + c.beg;
+  if(std::none_of(lits, lits+c.size, [this](int const  lit) { return  level(lit) == 2; })) {
+    int *const  last = std::remove_if(lits, lits+c.size, [this, id](int const  lit) {
+	if(level(lit) != 1)  return  false;
+	unlink(id, lit);
+	return  true;
+      });
+    m_stats.reduced += (lits+c.size) - last;
+    c.size = last - lits;
+  }
+  c.sig = signature(lits, lits+c.size);
+
+  switch(c.size) {
+  case 0:
+    kill(id);
+    m_conflict = true;
+    break;
+  case 1:
+    kill(id);
+    unlink(id, lits[0]);
+    assign(lits[0]);
+    break;
+  }
+}
+
+std::vector<unsigned>& Preprocessor::occurrences(int const  lit) {
+  std::vector<unsigned> &occs = m_occs[index(lit)];
+  occs.erase(std::remove_if(occs.begin(), occs.end(), [this](unsigned const  id) {
+	return  m_clauses[id].dead;
+      }), occs.end());
+  return  occs;
+}
+
+bool Preprocessor::subsumes(unsigned const  c, unsigned const  d, int &flip) const {
+  // Both clauses are sorted by variable
+  int const *it = begin(d);
+  int const *const  stop = end(d);
+  flip = 0;
+  for(int const *lit = begin(c); lit < end(c); lit++) {
+    while((it < stop) && (std::abs(*it) < std::abs(*lit)))  it++;
+    if((it == stop) || (std::abs(*it) != std::abs(*lit)))  return  false;
+    if(*it != *lit) {
+      if(flip != 0)  return  false;
+      flip = *lit;
+    }
+    it++;
+  }
+  return  true;
+}
+
+bool Preprocessor::resolve(unsigned const  c, unsigned const  d, int const  v, std::vector<int> &res) const {
+  res.clear();
+  int const *a = begin(c);
+  int const *b = begin(d);
+  while((a < end(c)) || (b < end(d))) {
+    int  lit;
+    if(b == end(d) || ((a < end(c)) && (std::abs(*a) < std::abs(*b))))  lit = *a++;
+    else if(a == end(c) || (std::abs(*b) < std::abs(*a)))  lit = *b++;
+    else {
+      if(*a != *b && std::abs(*a) != v)  return  false;
+      lit = *a++;
+      b++;
+    }
+    if(std::abs(lit) != v)  res.push_back(lit);
+  }
+  return  true;
+}
+
+void Preprocessor::propagate() {
+  while(!m_conflict && (m_head < m_trail.size())) {
+    int const  lit = m_trail[m_head++];
+    for(unsigned  id : m_occs[index(lit)])  kill(id);
+    std::vector<unsigned>().swap(m_occs[index(lit)]);
+
+    std::vector<unsigned>  falsified;
+    falsified.swap(m_occs[index(-lit)]);
+    for(unsigned  id : falsified) {
+      if(!m_clauses[id].dead)  strengthen(id, -lit);
+    }
+  }
+}
+
+void Preprocessor::substitute() {
+  unsigned const  nodes = m_occs.size();
+
+  // Implication Graph of the binary Clauses over Literal Indices
+  std::vector<unsigned>  first(nodes+1, 0);
+  for(Clause const &c : m_clauses) {
+    if(c.dead || (c.size != 2))  continue;
+    first[index(-m_lits[c.beg])+1]++;
+    first[index(-m_lits[c.beg+1])+1]++;
+  }
+  for(unsigned  i = 0; i < nodes; i++)  first[i+1] += first[i];
+  if(first[nodes] == 0)  return;
+  std::vector<unsigned>  edges(first[nodes]);
+  {
+    std::vector<unsigned>  fill(first.begin(), first.end()-1);
+    for(Clause const &c : m_clauses) {
+      if(c.dead || (c.size != 2))  continue;
+      int const  a = m_lits[c.beg];
+      int const  b = m_lits[c.beg+1];
+      edges[fill[index(-a)]++] = index(b);
+      edges[fill[index(-b)]++] = index(a);
+    }
+  }
+
+  // Strongly connected Components (Tarjan): equivalent Literals
+  std::vector<int>  repr(m_vals.size(), 0); // substitution by signal
+  {
+    std::vector<unsigned>  order(nodes, 0);  // visiting order + 1
+    std::vector<unsigned>  low  (nodes, 0);
+    std::vector<bool>      onstack(nodes, false);
+    std::vector<unsigned>  stack;
+    std::vector<std::pair<unsigned, unsigned>>  calls; // node with next edge
+    unsigned  visited = 0;
+
+    auto const  literal = [](unsigned const  node) -> int {
+      return  (node & 1)? -(int)(node >> 1) : (int)(node >> 1);
+    };
+    for(unsigned  root = 0; root < nodes; root++) {
+      if(order[root] || (first[root] == first[root+1]))  continue;
+      order[root] = low[root] = ++visited;
+      stack.push_back(root);
+      onstack[root] = true;
+      calls.emplace_back(root, first[root]);
+      while(!calls.empty()) {
+	unsigned const  v = calls.back().first;
+	if(calls.back().second < first[v+1]) {
+	  unsigned const  w = edges[calls.back().second++];
+	  if(!order[w]) {
+	    order[w] = low[w] = ++visited;
+	    stack.push_back(w);
+	    onstack[w] = true;
+	    calls.emplace_back(w, first[w]);
+	  }
+	  else if(onstack[w])  low[v] = std::min(low[v], order[w]);
+	  continue;
+	}
+	calls.pop_back();
+	if(!calls.empty()) {
+	  unsigned const  u = calls.back().first;
+	  low[u] = std::min(low[u], low[v]);
+	}
+	if(low[v] != order[v])  continue;
+
+	// Complete Component: substitute its Signals by its outermost Literal
+	unsigned const  top = std::find(stack.rbegin(), stack.rend(), v).base() - stack.begin() - 1;
+	int  rep = literal(v);
+	for(unsigned  i = top; i < stack.size(); i++) {
+	  int const  lit = literal(stack[i]);
+	  if((level(lit) < level(rep)) || ((level(lit) == level(rep)) && (std::abs(lit) < std::abs(rep))))  rep = lit;
+	  if(onstack[index(-lit)] && (order[index(-lit)] >= order[v]))  m_conflict = true;
+	}
+	for(unsigned  i = top; i < stack.size(); i++) {
+	  int const  lit = literal(stack[i]);
+	  onstack[stack[i]] = false;
+	  if((lit != rep) && (level(lit) == 2) && (repr[std::abs(lit)] == 0)) {
+	    repr[std::abs(lit)] = lit > 0? rep : -rep;
+	    m_stats.equivalences++;
+	  }
+	}
+	stack.resize(top);
+      }
+    }
+  }
+  if(m_conflict)  return;
+
+  // Rewrite the Clauses of the substituted Signals
+  for(unsigned  v = 1; v < repr.size(); v++) {
+    if(repr[v] == 0)  continue;
+    for(int const  lit : { (int)v, -(int)v }) {
+      std::vector<unsigned>  occs;
+      occs.swap(m_occs[index(lit)]);
+      for(unsigned  id : occs) {
+	if(m_clauses[id].dead)  continue;
+	kill(id);
+	m_buf.clear();
+	for(int const *it = begin(id); it < end(id); it++) {
+	  int const  r = repr[std::abs(*it)];
+	  m_buf.push_back(r == 0? *it : *it < 0? -r : r);
+	}
+	insert(m_buf);
+      }
+    }
+    m_gone[v] = true;
+  }
+}
+
+void Preprocessor::subsume() {
+  // Smaller Clauses first as they subsume more
+  std::vector<unsigned>  queue;
+  for(unsigned  id = 0; id < m_clauses.size(); id++) {
+    if(!m_clauses[id].dead)  queue.push_back(id);
+  }
+  std::stable_sort(queue.begin(), queue.end(), [this](unsigned  a, unsigned  b) {
+      return  m_clauses[a].size < m_clauses[b].size;
+    });
+
+  std::vector<unsigned>  cands;
+  for(unsigned  i = 0; (i < queue.size()) && !m_conflict; i++) {
+    unsigned const  c = queue[i];
+    if(m_clauses[c].dead)  continue;
+
+    // All candidates contain the variable of c occurring least often
+    int  pivot = *begin(c);
+    for(int const *it = begin(c); it < end(c); it++) {
+      if(m_occs[index(*it)].size() + m_occs[index(-*it)].size() <
+	 m_occs[index(pivot)].size() + m_occs[index(-pivot)].size())  pivot = *it;
+    }
+    if(m_occs[index(pivot)].size() + m_occs[index(-pivot)].size() > MAX_OCCS)  continue;
+    cands = m_occs[index(pivot)];
+    cands.insert(cands.end(), m_occs[index(-pivot)].begin(), m_occs[index(-pivot)].end());
+
+    for(unsigned  d : cands) {
+      Clause const &cc = m_clauses[c];
+      Clause const &dd = m_clauses[d];
+      if((d == c) || dd.dead || (dd.size < cc.size) || (cc.sig & ~dd.sig))  continue;
+
+      int  flip;
+      if(!subsumes(c, d, flip))  continue;
+      if(flip == 0) {
+	kill(d);
+	m_stats.subsumed++;
+      }
+      else {
+	strengthen(d, -flip);
+	m_stats.strengthened++;
+	if(!m_clauses[d].dead)  queue.push_back(d);
+      }
+      if(m_clauses[c].dead)  break;
+    }
+  }
+}
+
+void Preprocessor::eliminate() {
+  // Signals by Occurrences: cheap Eliminations first
+  std::vector<std::pair<unsigned, int>>  cands;
+  for(unsigned  v = m_configs+m_inputs+1; v < m_vals.size(); v++) {
+    if(!m_gone[v] && (m_vals[v] == 0)) {
+      cands.emplace_back(occurrences(v).size() + occurrences(-(int)v).size(), v);
+    }
+  }
+  std::sort(cands.begin(), cands.end());
+
+  std::vector<int>       res;
+  std::vector<int>       resolvents;
+  std::vector<unsigned>  sizes;
+  for(auto const &cand : cands) {
+    int const  v = cand.second;
+    if(m_conflict)  return;
+    if(m_vals[v] != 0)  continue;
+
+    std::vector<unsigned> const  pos = occurrences( v);
+    std::vector<unsigned> const  neg = occurrences(-v);
+    if(pos.size()*neg.size() > MAX_PAIRS)  continue;
+
+    // Only eliminate if the Number of Clauses does not grow
+    bool  ok = true;
+    resolvents.clear();
+    sizes.clear();
+    for(unsigned  p : pos) {
+      for(unsigned  q : neg) {
+	if(!resolve(p, q, v, res))  continue;
+	if((res.size() > MAX_RESOLVENT) || (sizes.size() == pos.size()+neg.size())) {
+	  ok = false;
+	  break;
+	}
+	resolvents.insert(resolvents.end(), res.begin(), res.end());
+	sizes.push_back(res.size());
+      }
+      if(!ok)  break;
+    }
+    if(!ok)  continue;
+
+    for(unsigned  id : pos)  kill(id);
+    for(unsigned  id : neg)  kill(id);
+    std::vector<unsigned>().swap(m_occs[index( v)]);
+    std::vector<unsigned>().swap(m_occs[index(-v)]);
+    m_gone[v] = true;
+    m_stats.eliminated++;
+
+    unsigned  beg = 0;
+    for(unsigned  size : sizes) {
+      m_buf.assign(resolvents.begin()+beg, resolvents.begin()+beg+size);
+      insert(m_buf);
+      beg += size;
+    }
+    propagate();
+  }
+}
+
+void Preprocessor::eliminateBlocked() {
+  // A clause is blocked on a signal if all its resolvents on it are
+  // tautological: the signal innermost may always be chosen to satisfy it
+  std::vector<bool>      mark(m_occs.size(), false);
+  std::vector<unsigned>  occs;
+  for(unsigned  v = m_configs+m_inputs+1; v < m_vals.size(); v++) {
+    if(m_gone[v] || (m_vals[v] != 0))  continue;
+    for(int const  lit : { (int)v, -(int)v }) {
+      std::vector<unsigned> const &others = occurrences(-lit);
+      if(others.size() > MAX_OCCS)  continue;
+      occs = occurrences(lit);
+      for(unsigned  c : occs) {
+	for(int const *it = begin(c); it < end(c); it++)  mark[index(*it)] = true;
+	bool  blocked = true;
+	for(unsigned  d : others) {
+	  if(m_clauses[d].dead)  continue;
+	  blocked = std::any_of(begin(d), end(d), [&mark, lit](int const  x) {
+	      return  (x != -lit) && mark[index(-x)];
+	    });
+	  if(!blocked)  break;
+	}
+	for(int const *it = begin(c); it < end(c); it++)  mark[index(*it)] = false;
+	if(blocked) {
+	  kill(c);
+	  m_stats.blocked++;
+	}
+      }
+    }
+  }
+}
+
+bool Preprocessor::run() {
+  propagate();
+  for(unsigned  round = 0; (round < ROUNDS) && !m_conflict; round++) {
+    unsigned long const  before = m_stats.total();
+    substitute();
+    propagate();
+    if(!m_conflict)  subsume();
+    propagate();
+    if(!m_conflict)  eliminate();
+    if(!m_conflict)  eliminateBlocked();
+    if(m_stats.total() == before)  break;
+  }
+
+  // Number the remaining Signals densely
+  unsigned const  first = m_configs + m_inputs;
+  m_rename.assign(m_vals.size(), 0);
+  for(unsigned  v = 1; v <= first; v++)  m_rename[v] = v;
+  for(Clause const &c : m_clauses) {
+    if(c.dead)  continue;
+    for(unsigned  i = c.beg; i < c.beg+c.size; i++) {
+      unsigned const  v = std::abs(m_lits[i]);
+      if(v > first)  m_rename[v] = 1;
+    }
+  }
+  m_signals = 0;
+  for(unsigned  v = first+1; v < m_rename.size(); v++) {
+    if(m_rename[v])  m_rename[v] = first + ++m_signals;
+  }
+  return !m_conflict;
+}
+
+unsigned long Preprocessor::size() const {
+  if(m_conflict)  return  1;
+  unsigned long  n = 0;
+  for(unsigned  v = 1; v <= m_configs; v++)  n += m_vals[v] != 0;
+  for(Clause const &c : m_clauses)  n += !c.dead;
+  return  n;
+}
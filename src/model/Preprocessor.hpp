@@ -0,0 +1,186 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef PREPROCESSOR_HPP
+#define PREPROCESSOR_HPP
+
+#include "ClauseSink.hpp"
+
+#include <vector>
+#include <cstdlib>
+
+/**
+ * This class simplifies a quantified formula of the form
+ *   exists config: forall inputs: exists signals: matrix
+ * received through the ClauseSink interface by:
+ *  - unit propagation,
+ *  - substitution of signals equivalent to other literals,
+ *  - subsumption and self-subsuming resolution,
+ *  - universal reduction of inputs from clauses without signals,
+ *  - bounded variable elimination of signals and
+ *  - elimination of clauses blocked on a signal.
+ * The configs are never eliminated so that the formula keeps exactly the
+ * same implementing configurations. Configs fixed by unit propagation are
+ * kept as unit clauses. The remaining signals are numbered densely.
+ *
+ * @author Thomas B. Preußer <thomas.preusser@utexas.edu>
+ */
+class Preprocessor : public ClauseSink {
+public:
+  /** Occurrences of a variable scanned for subsumption. */
+  static unsigned const  MAX_OCCS      = 1000;
+  /** Clause pairs resolved for the elimination of a signal. */
+  static unsigned const  MAX_PAIRS     = 1024;
+  /** Literals of a resolvent added by the elimination of a signal. */
+  static unsigned const  MAX_RESOLVENT = 16;
+  /** Rounds of all simplifications unless a fixpoint is reached earlier. */
+  static unsigned const  ROUNDS        = 4;
+
+  struct Stats {
+    unsigned long  units;        // variables fixed
+    unsigned long  equivalences; // signals substituted
+    unsigned long  subsumed;     // clauses removed
+    unsigned long  strengthened; // literals removed by self-subsumption
+    unsigned long  reduced;      // input literals removed
+    unsigned long  eliminated;   // signals resolved away
+    unsigned long  blocked;      // clauses removed
+
+    unsigned long total() const {
+      return  units + equivalences + subsumed + strengthened + reduced + eliminated + blocked;
+    }
+  };
+
+private:
+  struct Clause {
+    unsigned       beg;   // in m_lits
+    unsigned       size;
+    bool           dead;
+    unsigned long  sig;   // variables hashed into the bits
+  };
+
+  unsigned  m_configs;
+  unsigned  m_inputs;
+  unsigned  m_signals;
+  bool      m_conflict;    // empty clause derived
+
+  std::vector<int>                    m_lits;
+  std::vector<Clause>                 m_clauses;
+  std::vector<std::vector<unsigned>>  m_occs;    // clause IDs by literal index, lazily including dead ones
+  std::vector<signed char>            m_vals;    // by variable: 1 - true, -1 - false, 0 - open
+  std::vector<bool>                   m_gone;    // by variable: eliminated signal
+  std::vector<int>                    m_trail;   // assigned literals
+  unsigned                            m_head;    // next one of m_trail to propagate
+  std::vector<int>                    m_rename;  // by variable: dense output number
+  std::vector<int>                    m_buf;
+  Stats                               m_stats;
+
+  //- Construction / Destruction
+public:
+  Preprocessor()
+    : m_configs(0), m_inputs(0), m_signals(0), m_conflict(false), m_head(0), m_stats() {}
+  ~Preprocessor() {}
+
+  //- Formula Reception
+public:
+  void prefix(unsigned  configs, unsigned  inputs, unsigned  signals, unsigned long  clauses) override;
+  void clause(int const *beg, int const *end) override;
+
+  //- Simplification
+public:
+  /**
+   * Simplifies the received formula.
+   * @return false if the formula has been found to be false
+   */
+  bool run();
+
+  Stats const& stats() const { return  m_stats; }
+
+private:
+  /** 0 for configs, 1 for inputs and 2 for signals. */
+  unsigned level(int const  lit) const {
+    unsigned const  v = std::abs(lit);
+    return (v <= m_configs)? 0 : (v <= m_configs+m_inputs)? 1 : 2;
+  }
+  static unsigned index(int const  lit) { return  2*std::abs(lit) + (lit < 0); }
+  int value(int const  lit) const {
+    int const  val = m_vals[std::abs(lit)];
+    return  lit < 0? -val : val;
+  }
+  int const* begin(unsigned const  id) const { return  m_lits.data() + m_clauses[id].beg; }
+  int const* end  (unsigned const  id) const { return  begin(id) + m_clauses[id].size; }
+
+  /** Normalizes and adds the given clause, consuming it. */
+  void insert(std::vector<int> &lits);
+  void assign(int  lit);
+  void kill(unsigned const  id) { m_clauses[id].dead = true; }
+  void unlink(unsigned  id, int  lit);
+  /** Removes the literal from the clause. */
+  void strengthen(unsigned  id, int  lit);
+  /** Reduces the clause universally and turns it into a unit if possible. */
+  void settle(unsigned  id);
+  /** The IDs of the live clauses containing the literal, purging dead ones. */
+  std::vector<unsigned>& occurrences(int  lit);
+  /** Whether c subsumes d after flipping at most its literal flip. */
+  bool subsumes(unsigned  c, unsigned  d, int &flip) const;
+  /** The resolvent of c and d on v unless it is tautological. */
+  bool resolve(unsigned  c, unsigned  d, int  v, std::vector<int> &res) const;
+
+  void propagate();
+  void substitute();
+  void subsume();
+  void eliminate();
+  void eliminateBlocked();
+
+  //- Result Retrieval
+public:
+  /** The number of signals remaining in the simplified formula. */
+  unsigned signals() const { return  m_signals; }
+  /** The number of clauses in the simplified formula. */
+  unsigned long size() const;
+
+  /**
+   * Passes the clauses of the simplified formula to f. The configs and
+   * inputs keep their numbers, the signals are numbered densely after them.
+   * A false formula only consists of the empty clause.
+   */
+  template<typename F>
+  void forEach(F &&f) const {
+    std::vector<int>  buf;
+    if(m_conflict) {
+      f(buf.data(), buf.data());
+      return;
+    }
+    for(unsigned  v = 1; v <= m_configs; v++) {
+      if(m_vals[v] != 0) {
+	int const  lit = m_vals[v] > 0? (int)v : -(int)v;
+	f(&lit, &lit+1);
+      }
+    }
+    for(unsigned  id = 0; id < m_clauses.size(); id++) {
+      if(m_clauses[id].dead)  continue;
+      buf.clear();
+      for(int const *it = begin(id); it < end(id); it++) {
+	int const  v = m_rename[std::abs(*it)];
+	buf.push_back(*it < 0? -v : v);
+      }
+      f(buf.data(), buf.data()+buf.size());
+    }
+  }
+};
+#endif
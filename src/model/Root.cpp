@@ -21,54 +21,746 @@
 #include "Context.hpp"
 
 #include "Quantor.hpp"
+#include "Cegar.hpp"
+#include "Expansion.hpp"
+#include "External.hpp"
+#include "Preprocessor.hpp"
 
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <memory>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <set>
+#include <tuple>
 
-Root::Root(CompDecl const &decl, std::vector<int> const &generics)
+Root::Root(CompDecl const &decl, std::vector<int> const &generics,
+	   std::vector<Target> const &targets,
+	   Encoding  encoding, Selection  selection, Multiplex  multiplex,
+	   Symmetry  symmetry, unsigned  threads)
   : m_top(""),
     m_confignxt(FIRST_CONFIG),
     m_inputnxt (FIRST_INPUT),
-    m_signalnxt(FIRST_SIGNAL) {
+    m_signalnxt(FIRST_SIGNAL),
+    m_selection(selection),
+    m_multiplex(multiplex),
+    m_symmetry(symmetry),
+    m_recording(symmetry == Symmetry::BREAK),
+    m_muted(0),
+    m_threads(threads? threads : std::max(1u, std::thread::hardware_concurrency())),
+    m_scratch(false),
+    m_deferring(symmetry == Symmetry::KEEP) {
 
-  std::map<std::string, int>  params;
+  SymbolMap<int>  params;
   { // Compute Generic Parameters
     unsigned const  n = generics.size();
     if(n != decl.countParameters())  throw "Wrong number of parameters.";
     for(unsigned  i = 0; i < n; i++)  params[decl.getParameter(i).name()] = generics[i];
   }
 
-  Context  ctx(*this, m_top, std::move(params));
-  decl.forAllPorts([this, &ctx](PortDecl const &decl) {
+  Context           ctx(*this, m_top, std::move(params));
+  std::vector<Bus>  ports;
+  decl.forAllPorts([this, &ctx, &ports](PortDecl const &decl) {
       int const  width = ctx.computeConstant(decl.width());
-      ctx.registerSignal(decl.name(), decl.direction() == PortDecl::Direction::in? allocateInput(width) : allocateSignal(width));
+      ports.push_back(decl.direction() == PortDecl::Direction::in? allocateInput(width) : allocateSignal(width));
+      ctx.registerSignal(decl.name(), ports.back());
     });
   ctx.compile("<top>", decl);
+  elaborateDeferred();
+
+  for(Target const &target : targets) {
+    CompDecl const &tdecl = *target.decl;
+    std::string const  label = "target" + std::to_string(m_targets.size());
+    int         const  act   = allocateConfig(1)[0];
+    m_targets.push_back(act);
+
+    SymbolMap<int>  tparams;
+    { // Compute Generic Parameters
+      unsigned const  n = target.generics.size();
+      if(n != tdecl.countParameters())  throw "Wrong number of parameters.";
+      for(unsigned  i = 0; i < n; i++)  tparams[tdecl.getParameter(i).name()] = target.generics[i];
+    }
+
+    // Share the inputs, bind fresh outputs to the structure when activated
+    Context  tctx(ctx, label + '/', std::move(tparams), SymbolMap<Bus>());
+    std::vector<std::pair<Bus, Bus>>  outputs;
+    unsigned const  n = ports.size();
+    if(n != tdecl.countPorts())  throw  label + ": Wrong number of ports.";
+    for(unsigned  i = 0; i < n; i++) {
+      PortDecl const &port  = tdecl.getPort(i);
+      Bus      const &bus   = ports[i];
+      bool     const  in    = port.direction() == PortDecl::Direction::in;
+      unsigned const  width = tctx.computeConstant(port.width());
+      if((width != bus.width()) || (in != (decl.getPort(i).direction() == PortDecl::Direction::in))) {
+	throw  label + ": Port " + port.name().str() + " does not match the structure.";
+      }
+      if(in)  tctx.registerSignal(port.name(), bus);
+      else {
+	Bus const  out = allocateSignal(width);
+	tctx.registerSignal(port.name(), out);
+	outputs.emplace_back(bus, out);
+      }
+    }
+    tctx.compile(label, tdecl);
+    elaborateDeferred();
+
+    for(auto const &out : outputs) {
+      for(unsigned  i = 0; i < out.first.width(); i++) {
+	addClause({-act,  out.first[i], -out.second[i]});
+	addClause({-act, -out.first[i],  out.second[i]});
+      }
+    }
+  }
+  finalize(encoding);
 }
 
+Root::Root(Selection  selection, Multiplex  multiplex)
+  : m_top(""),
+    m_confignxt(FIRST_CONFIG),
+    m_inputnxt (FIRST_INPUT),
+    m_signalnxt(FIRST_SIGNAL),
+    m_selection(selection),
+    m_multiplex(multiplex),
+    m_symmetry(Symmetry::KEEP),
+    m_recording(false),
+    m_muted(0),
+    m_threads(1),
+    m_scratch(true),
+    m_deferring(false) {}
+
 Bus Root::allocateConfig(unsigned  width) {
-  Node *const  nodes = new Node[width];
-  for(unsigned  i = 0; i < width; i++) {
-    nodes[i] = m_confignxt++;
-  }
-  return  Bus(width, nodes);
+  return  Bus::build(width, [this](unsigned) { return  m_confignxt++; });
 }
 
 Bus Root::allocateInput (unsigned  width) {
-  Node *const  nodes = new Node[width];
-  for(unsigned  i = 0; i < width; i++) {
-    nodes[i] = m_inputnxt++;
-  }
-  return  Bus(width, nodes);
+  return  Bus::build(width, [this](unsigned) { return  m_inputnxt++; });
 }
 
 Bus Root::allocateSignal(unsigned  width) {
-  Node *const  nodes = new Node[width];
+  return  Bus::build(width, [this](unsigned) { return  m_signalnxt++; });
+}
+
+int Root::gate(GateKey const &key) {
+  auto const  it = m_gates.find(key);
+  if(it != m_gates.end())  return  find(it->second);
+
+  int const  y = m_signalnxt++;
+  m_gates.emplace(key, y);
+  m_gatedefs.push_back(GateDef{y, key, 0});
+  return  y;
+}
+
+int Root::find(int  lit) {
+  // Follow the aliases to the representative literal
+  int  r = lit;
+  while(true) {
+    unsigned const  i = std::abs(r) - FIRST_SIGNAL;
+    if((std::abs(r) < FIRST_SIGNAL) || (i >= m_aliases.size()) || (m_aliases[i] == 0))  break;
+    r = r < 0? -m_aliases[i] : m_aliases[i];
+  }
+
+  // Compress the traversed path
+  while(std::abs(lit) != std::abs(r)) {
+    unsigned const  i = std::abs(lit) - FIRST_SIGNAL;
+    int      const  a = m_aliases[i];
+    m_aliases[i] = lit < 0? -r : r;
+    lit = lit < 0? -a : a;
+  }
+  return  r;
+}
+
+void Root::equate(Node  a, Node  b) {
+  use(a);
+  use(b);
+  int  x = find(a);
+  int  z = find(b);
+  if(x ==  z)  return;
+  if(x == -z) { addClause(nullptr, nullptr); return; }
+
+  // Alias the younger variable if it is a signal
+  if(std::abs(x) < std::abs(z))  std::swap(x, z);
+  if(std::abs(x) >= FIRST_SIGNAL) {
+    unsigned const  i = std::abs(x) - FIRST_SIGNAL;
+    if(i >= m_aliases.size())  m_aliases.resize(i+1, 0);
+    m_aliases[i] = x < 0? -z : z;
+    return;
+  }
+
+  // Fall back to clauses among inputs and configs
+  addClause({ x, -z});
+  addClause({-x,  z});
+}
+
+void Root::finalize(Encoding  encoding) {
+  breakSymmetries();
+
+  { // Resolve Aliases within collected Clauses
+    std::vector<int>       lits (m_clauses.literals());
+    std::vector<unsigned>  sizes(m_clauses.size());
+    for(unsigned  id = 0; id < sizes.size(); id++)  sizes[id] = m_clauses.end(id) - m_clauses.begin(id);
+    m_clauses.clear();
+    for(int &lit : lits)  lit = find(lit);
+    int const *beg = lits.data();
+    for(unsigned  size : sizes) {
+      addClause(beg, beg+size);
+      beg += size;
+    }
+  }
+  for(GateDef &def : m_gatedefs) {
+    def.y = find(def.y);
+    GateKey &k = def.key;
+    k.a = find(k.a);
+    k.b = find(k.b);
+    if(k.op == GateKey::Op::MUX)  k.c = find(k.c);
+  }
+
+  // Polarities in which the signals are referenced
+  unsigned char const  POS  = GateDef::POS;
+  unsigned char const  NEG  = GateDef::NEG;
+  unsigned char const  BOTH = GateDef::BOTH;
+  unsigned const  n = m_signalnxt - FIRST_SIGNAL;
+  std::vector<unsigned char>  pol(n, encoding == Encoding::FULL? BOTH : 0);
+  auto const  need = [&pol](int const  lit) -> unsigned char {
+    // Gates merged with constants only constrain in one polarity
+    if(lit == Node::TOP)  return  POS;
+    if(lit == Node::BOT)  return  NEG;
+    if(std::abs(lit) < FIRST_SIGNAL)  return  BOTH;
+    unsigned char const  p = pol[std::abs(lit) - FIRST_SIGNAL];
+    return  lit > 0? p : ((p & POS)? NEG : 0) | ((p & NEG)? POS : 0);
+  };
+
+  if(encoding == Encoding::POLARITY) {
+    // Gates by their output signal
+    std::vector<std::vector<unsigned>>  defs(n);
+    for(unsigned  i = 0; i < m_gatedefs.size(); i++) {
+      int const  y = std::abs(m_gatedefs[i].y);
+      if(y >= FIRST_SIGNAL)  defs[y - FIRST_SIGNAL].push_back(i);
+    }
+
+    // Propagate polarities backwards through the gates until fixpoint:
+    //   aliasing may merge outputs with earlier signals or even form cycles
+    std::vector<unsigned>  work;
+    auto const  mark = [&pol, &work](int const  lit, unsigned char  p) {
+      if(std::abs(lit) < FIRST_SIGNAL)  return;
+      if(lit < 0)  p = ((p & POS)? NEG : 0) | ((p & NEG)? POS : 0);
+      unsigned       const  v = std::abs(lit) - FIRST_SIGNAL;
+      unsigned char  const  q = pol[v] | p;
+      if(q != pol[v]) {
+	pol[v] = q;
+	work.push_back(v);
+      }
+    };
+    auto const  propagate = [&](GateDef const &def) {
+      unsigned char const  p = need(def.y);
+      GateKey       const &k = def.key;
+      if(p == 0)  return;
+      switch(k.op) {
+      case GateKey::Op::AND: mark(k.a, p);    mark(k.b, p);    break;
+      case GateKey::Op::XOR: mark(k.a, BOTH); mark(k.b, BOTH); break;
+      case GateKey::Op::MUX: mark(k.a, BOTH); mark(k.b, p); mark(k.c, p); break;
+      }
+    };
+
+    // A gate only defines its output signal if it is the single one to
+    //   do so and does not depend on itself. Other gates merged by aliasing
+    //   constrain their outputs and are needed in both polarities.
+    std::vector<unsigned>               pending(n, 0); // defined operands
+    std::vector<std::vector<unsigned>>  readers(n);
+    for(unsigned  v = 0; v < n; v++) {
+      for(unsigned  i : defs[v]) {
+	GateKey const &k = m_gatedefs[i].key;
+	for(int  lit : { k.a, k.b, k.op == GateKey::Op::MUX? k.c : 0 }) {
+	  if(std::abs(lit) < FIRST_SIGNAL)  continue;
+	  unsigned const  u = std::abs(lit) - FIRST_SIGNAL;
+	  if(defs[u].empty())  continue;
+	  pending[v]++;
+	  readers[u].push_back(v);
+	}
+      }
+    }
+    for(unsigned  v = 0; v < n; v++) {
+      if(!defs[v].empty() && (pending[v] == 0))  work.push_back(v);
+    }
+    while(!work.empty()) {
+      unsigned const  u = work.back();
+      work.pop_back();
+      for(unsigned  v : readers[u]) {
+	if(--pending[v] == 0)  work.push_back(v);
+      }
+    }
+
+    for(int  lit : m_clauses.literals())  mark(lit, POS);
+    for(unsigned  v = 0; v < n; v++) {
+      if((defs[v].size() > 1) || (pending[v] > 0))  mark(FIRST_SIGNAL + v, BOTH);
+    }
+    for(GateDef const &def : m_gatedefs) {
+      if(std::abs(def.y) < FIRST_SIGNAL)  propagate(def);
+    }
+    while(!work.empty()) {
+      unsigned const  v = work.back();
+      work.pop_back();
+      for(unsigned  i : defs[v])  propagate(m_gatedefs[i]);
+    }
+  }
+
+  // Keep the Gates referenced in some Polarity: those only constraining
+  //   their output after aliasing, i.e. sharing it with other gates or
+  //   some operand, rather join the normalized and deduplicated clauses
+  std::vector<unsigned>  defined(n, 0);
+  for(GateDef const &def : m_gatedefs) {
+    if(std::abs(def.y) >= FIRST_SIGNAL)  defined[std::abs(def.y) - FIRST_SIGNAL]++;
+  }
+  auto const  defines = [&defined](GateDef const &def) -> bool {
+    GateKey const &k = def.key;
+    int const  y = std::abs(def.y);
+    int const  a = std::abs(k.a);
+    int const  b = std::abs(k.b);
+    int const  c = k.op == GateKey::Op::MUX? std::abs(k.c) : -1;
+    return (y >= FIRST_SIGNAL) && (defined[y - FIRST_SIGNAL] == 1) &&
+      (y != a) && (y != b) && (y != c) && (a != b) && (a != c) && (b != c);
+  };
+  for(GateDef &def : m_gatedefs) {
+    def.pol = need(def.y);
+    if(def.pol && !defines(def)) {
+      gateClauses(def, [this](std::initializer_list<int> const  clause) { addClause(clause); });
+      def.pol = 0;
+    }
+  }
+  m_gatedefs.erase(std::remove_if(m_gatedefs.begin(), m_gatedefs.end(),
+				  [](GateDef const &def) { return  def.pol == 0; }),
+		   m_gatedefs.end());
+
+  { // Number the remaining Signals densely
+    std::vector<int>  index(n, 0);
+    auto const  use = [&index](int const  lit) {
+      if(std::abs(lit) >= FIRST_SIGNAL)  index[std::abs(lit) - FIRST_SIGNAL] = 1;
+    };
+    auto const  renumber = [&index](int &lit) {
+      if(lit >=  FIRST_SIGNAL)  lit =  index[ lit - FIRST_SIGNAL];
+      if(lit <= -FIRST_SIGNAL)  lit = -index[-lit - FIRST_SIGNAL];
+    };
+
+    for(int  lit : m_clauses.literals())  use(lit);
+    for(GateDef const &def : m_gatedefs) {
+      use(def.y);
+      use(def.key.a);
+      use(def.key.b);
+      if(def.key.op == GateKey::Op::MUX)  use(def.key.c);
+    }
+    m_signalnxt = FIRST_SIGNAL;
+    for(int &idx : index) {
+      if(idx)  idx = m_signalnxt++;
+    }
+    m_clauses.rename(renumber);
+    for(GateDef &def : m_gatedefs) {
+      renumber(def.y);
+      renumber(def.key.a);
+      renumber(def.key.b);
+      if(def.key.op == GateKey::Op::MUX)  renumber(def.key.c);
+    }
+  }
+
+  // Elaboration is complete
+  m_gates.clear();
+  m_decoders.clear();
+  m_templates.clear();
+  m_gatedefs.shrink_to_fit();
+  std::vector<int>().swap(m_aliases);
+}
+
+bool Root::readTable(Bus const &lhs, Bus const &rhs) {
+  unsigned const  width = rhs.width();
+  if(!m_recording || (width >= 16) || (lhs.width() != (1u << width)))  return  false;
+
+  Table  table;
+  for(unsigned  i = 0; i < lhs.width(); i++) {
+    int const  v = lhs[i];
+    if((v < FIRST_CONFIG) || (v >= FIRST_INPUT))  return  false;
+    table.lines.push_back(v);
+  }
+  std::vector<int>  sorted(table.lines);
+  std::sort(sorted.begin(), sorted.end());
+  if(std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())  return  false;
+
+  // Negated address bits are compensated by the table just as well
+  for(unsigned  i = 0; i < width; i++)  table.address.push_back(std::abs(rhs[i]));
+  m_tables.push_back(std::move(table));
+  return  true;
+}
+
+unsigned Root::enterInstance(CompDecl const &decl, std::vector<int> const &generics,
+			     std::vector<Bus> const &inputs, std::vector<Bus> const &outputs) {
+  if(!m_recording || (outputs.size() != 1) || (outputs[0].width() != 1))  return ~0u;
+  int const  y = outputs[0][0];
+  if(y < FIRST_SIGNAL)  return ~0u;
+
+  Instance  inst;
+  inst.decl = &decl;
+  inst.key  = generics;
+  for(Bus const &bus : inputs) {
+    inst.key.push_back(bus.width());
+    for(unsigned  i = 0; i < bus.width(); i++)  inst.key.push_back(find(bus[i]));
+  }
+  inst.output = y;
+  inst.usebeg = inst.useend = m_uses.size();
+  inst.cfgbeg = inst.cfgend = m_confignxt;
+  m_instances.push_back(std::move(inst));
+  return  m_instances.size()-1;
+}
+
+void Root::leaveInstance(unsigned  id) {
+  if(id == ~0u)  return;
+  m_instances[id].useend = m_uses.size();
+  m_instances[id].cfgend = m_confignxt;
+}
+
+Root::TemplateKey Root::templateKey(CompDecl const &decl, std::vector<int> const &generics,
+				    std::vector<Bus> const &ports, std::vector<int> &lits) {
+  // Port bits as constants or by their first occurrence
+  std::vector<int>              key(generics);
+  std::unordered_map<int, int>  first;
+  lits.clear();
+  for(Bus const &bus : ports) {
+    key.push_back(bus.width());
+    for(unsigned  i = 0; i < bus.width(); i++) {
+      int const  lit = find(bus[i]);
+      lits.push_back(lit);
+      if((lit == Node::TOP) || (lit == Node::BOT))  key.push_back(lit);
+      else {
+	int const  k = first.emplace(std::abs(lit), lits.size()+1).first->second;
+	key.push_back(lit < 0? -k : k);
+      }
+    }
+  }
+
+  return  TemplateKey(&decl, std::move(key));
+}
+
+Template const* Root::beginTemplate(CompDecl const &decl, std::vector<int> const &generics,
+				   std::vector<Bus> const &ports) {
+  if(m_recording)  return  nullptr;
+
+  std::vector<int>  lits;
+  TemplateKey       tkey = templateKey(decl, generics, ports, lits);
+  auto const  it = m_templates.find(tkey);
+  if(it != m_templates.end())  return  it->second.get();
+  m_tapes.emplace_back(std::move(tkey), std::unique_ptr<Template>(new Template(lits, m_signalnxt)));
+  return  nullptr;
+}
+
+void Root::endTemplate(Scope const &scope) {
+  if(m_recording)  return;
+  auto &tape = m_tapes.back();
+  tape.second->finish(scope);
+  if(tape.second->valid())  m_templates.emplace(std::move(tape.first), std::move(tape.second));
+  m_tapes.pop_back();
+}
+
+bool Root::defer(Scope &scope, std::string const &label, CompDecl const &decl,
+		 std::vector<int> const &generics, std::vector<Bus> const &ports) {
+  if(!m_deferring)  return  false;
+
+  std::vector<int>  lits;
+  m_deferred.push_back(Deferred{&scope.createChild(label + '/'), label, &decl, generics, ports, templateKey(decl, generics, ports, lits)});
+  return  true;
+}
+
+std::unique_ptr<Template> Root::record(Deferred const &inst) const {
+  Root  scratch(m_selection, m_multiplex);
+
+  // Ports: constants or one fresh signal for each distinct bit
+  SymbolMap<int>  params;
+  for(unsigned  i = 0; i < inst.generics.size(); i++)  params[inst.decl->getParameter(i).name()] = inst.generics[i];
+  Context  ctx(scratch, scratch.m_top, std::move(params));
+
+  std::vector<int> const &key = inst.key.second;
+  std::vector<int>        lits;
+  std::vector<int>        fresh(key.size(), 0);
+  unsigned  pos = inst.generics.size();
+  for(unsigned  i = 0; i < inst.ports.size(); i++) {
+    unsigned const  width = key[pos++];
+    ctx.registerSignal(inst.decl->getPort(i).name(), Bus::build(width, [&](unsigned) {
+	  int const  k = key[pos++];
+	  int  lit = k;
+	  if((k != Node::TOP) && (k != Node::BOT)) {
+	    int &v = fresh[std::abs(k)];
+	    if(v == 0)  v = scratch.m_signalnxt++;
+	    lit = k < 0? -v : v;
+	  }
+	  lits.push_back(lit);
+	  return  lit;
+	}));
+  }
+
+  std::unique_ptr<Template>  tmpl(new Template(lits, scratch.m_signalnxt));
+  scratch.m_tapes.emplace_back(inst.key, std::move(tmpl));
+  ctx.compile(inst.label, *inst.decl);
+  tmpl = std::move(scratch.m_tapes.back().second);
+  tmpl->finish(scratch.m_top);
+  return  tmpl;
+}
+
+void Root::elaborateDeferred() {
+  std::vector<Deferred>  insts;
+  insts.swap(m_deferred);
+
+  // Record the templates missing for distinct instances in parallel
+  std::vector<Deferred const*>  missing;
+  {
+    std::set<TemplateKey>  seen;
+    for(Deferred const &inst : insts) {
+      if((m_templates.find(inst.key) == m_templates.end()) && seen.insert(inst.key).second)  missing.push_back(&inst);
+    }
+  }
+  std::vector<std::unique_ptr<Template>>  recorded(missing.size());
+  std::vector<std::string>                errors(missing.size());
+  std::atomic<unsigned>                   next(0);
+  auto const  work = [this, &missing, &recorded, &errors, &next]() {
+    for(unsigned  k; (k = next++) < missing.size();) {
+      try {
+	recorded[k] = record(*missing[k]);
+      }
+      catch(char const *const  msg) { errors[k] = msg; }
+      catch(std::string const &msg) { errors[k] = msg; }
+    }
+  };
+  {
+    unsigned const  n = std::min<unsigned>(m_threads, missing.size());
+    std::vector<std::thread>  workers;
+    for(unsigned  t = 1; t < n; t++)  workers.emplace_back(work);
+    work();
+    for(std::thread &w : workers)  w.join();
+  }
+  for(unsigned  k = 0; k < missing.size(); k++) {
+    if(!errors[k].empty())  throw  errors[k];
+    if(recorded[k]->valid())  m_templates.emplace(missing[k]->key, std::move(recorded[k]));
+  }
+
+  // Merge in the order of instantiation
+  bool const  deferring = m_deferring;
+  m_deferring = false;
+  for(Deferred const &inst : insts) {
+    auto const  it = m_templates.find(inst.key);
+    if(it != m_templates.end()) {
+      std::cout << "Compiling " << inst.label << " : " << inst.decl->name() << " ..." << std::endl;
+      Context  ctx(*this, *inst.scope);
+      it->second->replay(ctx, *inst.scope, inst.ports);
+      continue;
+    }
+
+    // Compile in place without a template
+    SymbolMap<int>  params;
+    for(unsigned  i = 0; i < inst.generics.size(); i++)  params[inst.decl->getParameter(i).name()] = inst.generics[i];
+    Context  ctx(*this, *inst.scope, std::move(params));
+    for(unsigned  i = 0; i < inst.ports.size(); i++)  ctx.registerSignal(inst.decl->getPort(i).name(), inst.ports[i]);
+    ctx.compile(inst.label, *inst.decl);
+  }
+  m_deferring = deferring;
+}
+
+Bus Root::traced(Bus const &bus) {
+  if(!m_tapes.empty()) {
+    std::vector<int>  lits;
+    for(unsigned  i = 0; i < bus.width(); i++)  lits.push_back(bus[i]);
+    recordYield(lits.data(), lits.data()+lits.size());
+  }
+  return  bus;
+}
+
+void Root::recordStep(Template::Op const  op, int const *beg, int const *end) {
+  std::vector<int>  args(beg, end);
+  if((op != Template::Op::CONFIG) && (op != Template::Op::SIGNAL)) {
+    for(int &lit : args)  lit = find(lit);
+  }
+  for(auto &tape : m_tapes)  tape.second->step(op, args.data(), args.data()+args.size());
+}
+
+void Root::recordYield(int const *beg, int const *end) {
+  std::vector<int>  lits(beg, end);
+  for(int &lit : lits)  lit = find(lit);
+  for(auto &tape : m_tapes)  tape.second->yield(lits.data(), lits.data()+lits.size());
+}
+
+void Root::breakSymmetries() {
+  m_recording = false;
+
+  // Uses of the interesting nodes: instance outputs and table lines
+  std::unordered_map<int, std::vector<unsigned>>  uses;
+  std::unordered_map<int, std::vector<unsigned>>  addressed;  // output -> tables
+  std::unordered_map<int, unsigned>               reads;      // line -> tables
+  for(Instance const &inst : m_instances) {
+    uses[inst.output];
+    addressed[inst.output];
+  }
+  for(Table const &table : m_tables) {
+    for(int  v : table.lines) {
+      uses[v];
+      reads[v]++;
+    }
+  }
+  for(unsigned  i = 0; i < m_uses.size(); i++) {
+    auto const  it = uses.find(m_uses[i]);
+    if(it != uses.end())  it->second.push_back(i);
+  }
+
+  // Tables whose lines can be permuted freely
+  std::vector<bool>  exclusive(m_tables.size(), true);
+  for(unsigned  k = 0; k < m_tables.size(); k++) {
+    for(int  v : m_tables[k].lines) {
+      if(!uses[v].empty() || (reads[v] != 1))  exclusive[k] = false;
+    }
+    for(int  v : m_tables[k].address) {
+      auto const  it = addressed.find(v);
+      if(it != addressed.end())  it->second.push_back(k);
+    }
+  }
+
+  // Classes of Instances whose Outputs only address the same Tables
+  std::map<std::tuple<CompDecl const*, std::vector<int>, std::vector<unsigned>>, std::vector<unsigned>>  classes;
+  for(unsigned  i = 0; i < m_instances.size(); i++) {
+    Instance              const &inst = m_instances[i];
+    std::vector<unsigned> const &tabs = addressed[inst.output];
+    bool  ok = !tabs.empty() && (inst.cfgend > inst.cfgbeg) &&
+      (std::adjacent_find(tabs.begin(), tabs.end()) == tabs.end());
+    for(unsigned  k : tabs)  ok = ok && exclusive[k];
+    for(unsigned  pos : uses[inst.output]) {
+      if((pos < inst.usebeg) || (pos >= inst.useend))  ok = false;
+    }
+    if(ok)  classes[std::make_tuple(inst.decl, inst.key, tabs)].push_back(i);
+  }
+
+  for(auto const &cls : classes) {
+    std::vector<unsigned> const &members = cls.second;
+    if(members.size() < 2)  continue;
+
+    // No member may feed another
+    bool  ok = true;
+    for(unsigned  i : members) {
+      std::vector<int> const &key = m_instances[i].key;
+      for(unsigned  j : members) {
+	if(std::find(key.begin(), key.end(), m_instances[j].output) != key.end())  ok = false;
+      }
+    }
+    if(!ok)  continue;
+
+    std::cout << "Ordering configs of " << members.size() << " interchangeable instances of "
+	      << std::get<0>(cls.first)->name() << std::endl;
+    for(unsigned  m = 1; m < members.size(); m++) {
+      Instance const &x = m_instances[members[m-1]];
+      Instance const &z = m_instances[members[m]];
+
+      // x <= z lexicographically with e: equal so far
+      int  e = Node::TOP;
+      for(int  k = 0; k < x.cfgend - x.cfgbeg; k++) {
+	int const  a = x.cfgbeg + k;
+	int const  b = z.cfgbeg + k;
+	addClause({-e, -a, b});
+	if(k+1 < x.cfgend - x.cfgbeg) {
+	  int const  f = allocateConfig(1)[0];
+	  addClause({-e,  a,  b, f});
+	  addClause({-e, -a, -b, f});
+	  e = f;
+	}
+      }
+    }
+  }
+
+  std::vector<int>().swap(m_uses);
+  std::vector<Table>().swap(m_tables);
+  std::vector<Instance>().swap(m_instances);
+}
+
+Node Root::gateAnd(Node  a, Node  b) {
+  use(a);
+  use(b);
+  int  x = find(a);
+  int  z = find(b);
+  if(x > z)  std::swap(x, z);
+
+  // Constant Folding
+  if((x == Node::BOT) || (x == -z))  return  Node::BOT;
+  if((x == Node::TOP) || (x ==  z))  return  z;
+  if( z == Node::TOP)                return  x;
+
+  return  gate(GateKey{GateKey::Op::AND, x, z, 0});
+}
+
+Node Root::gateXor(Node  a, Node  b) {
+  // Normalize to positive operands
+  use(a);
+  use(b);
+  int   x   = find(a);
+  int   z   = find(b);
+  bool  inv = false;
+  if(x < 0) { x = -x; inv = !inv; }
+  if(z < 0) { z = -z; inv = !inv; }
+  if(x > z)  std::swap(x, z);
+
+  // Constant Folding
+  if(x == z)          return  inv? Node::TOP : Node::BOT;
+  if(x == Node::TOP)  return  inv? z : -z;
+
+  int const  y = gate(GateKey{GateKey::Op::XOR, x, z, 0});
+  return  inv? -y : y;
+}
+
+Node Root::gateMux(Node  s, Node  a, Node  b) {
+  use(s);
+  use(a);
+  use(b);
+  s = find(s);
+  a = find(a);
+  b = find(b);
+
+  // Constant Folding
+  if(s == Node::TOP)  return  a;
+  if(s == Node::BOT)  return  b;
+  if(a == b)          return  a;
+  if(a == -b)         return  gateXor(s, b);
+  if((a == Node::TOP) || (a ==  s))  return  gateOr ( s, b);
+  if((a == Node::BOT) || (a == -s))  return  gateAnd(-s, b);
+  if((b == Node::TOP) || (b == -s))  return  gateOr (-s, a);
+  if((b == Node::BOT) || (b ==  s))  return  gateAnd( s, a);
+
+  // Normalize to positive select and positive first operand
+  int   c   = s;
+  int   x   = a;
+  int   z   = b;
+  bool  inv = false;
+  if(c < 0) { c = -c; std::swap(x, z); }
+  if(x < 0) { x = -x; z = -z; inv = true; }
+
+  int const  y = gate(GateKey{GateKey::Op::MUX, c, x, z});
+  return  inv? -y : y;
+}
+
+std::vector<int> const& Root::decode(Bus const &sel, unsigned  width) {
+  std::vector<int>  key(width);
   for(unsigned  i = 0; i < width; i++) {
-    nodes[i] = m_signalnxt++;
+    use(sel[i]);
+    key[i] = find(sel[i]);
   }
-  return  Bus(width, nodes);
+
+  auto const  it = m_decoders.find(key);
+  if(it != m_decoders.end())  return  it->second;
+
+  // Extend the minterms by one selector bit after the other
+  std::vector<int>  terms(1, (int)Node::TOP);
+  terms.reserve(1u << width);
+  for(int  bit : key) {
+    unsigned const  n = terms.size();
+    terms.resize(2*n);
+    for(unsigned  l = 0; l < n; l++) {
+      terms[n+l] = gateAnd(terms[l],  bit);
+      terms[l]   = gateAnd(terms[l], -bit);
+    }
+  }
+  return  m_decoders.emplace(std::move(key), std::move(terms)).first->second;
 }
 
 namespace {
@@ -111,30 +803,101 @@ void Root::print(std::ostream &out, Bus const &bus) const {
 }
 
 void Root::addClause(int const *beg, int const *end) {
-  auto const  size = m_clauses.size();
+  m_clause.clear();
   while(beg < end) {
     int const v = *beg++;
+    use(v);
     switch(v) {
     default:
-      m_clauses.push_back(v);
+      m_clause.push_back(v);
     case Node::BOT:
       continue;
     case Node::TOP:
-      // Rollback to remove already satisfied clause
-      m_clauses.resize(size);
+      // Drop already satisfied clause
       return;
     }
   }
-  m_clauses.push_back(0);
+  m_clauses.add(m_clause.data(), m_clause.data()+m_clause.size());
 }
 
-void Root::dumpClauses(std::ostream &out) const {
-  for(int  v : m_clauses) {
-    if(v == 0)  out << std::endl;
-    else  out << Lit(v) << ' ';
+template<typename F>
+void Root::forEachClause(F &&f) const {
+  m_clauses.forEach(f);
+  forEachGateClause(f);
+}
+
+template<typename F>
+void Root::forEachGateClause(F &&f) const {
+  // Gate Clauses normalized like those of the ClauseDB with constants removed
+  auto const  out = [&f](std::initializer_list<int> const  clause) {
+    int       buf[3];
+    unsigned  n = 0;
+    for(int  lit : clause) {
+      if(lit == Node::TOP)  return;
+      if(lit != Node::BOT)  buf[n++] = lit;
+    }
+    for(unsigned  i = 1; i < n; i++) {
+      for(unsigned  j = i; j > 0; j--) {
+	int const  a = buf[j-1];
+	int const  b = buf[j];
+	if(std::abs(a) < std::abs(b) || (std::abs(a) == std::abs(b) && a < b))  break;
+	buf[j-1] = b;
+	buf[j]   = a;
+      }
+    }
+    n = std::unique(buf, buf+n) - buf;
+    for(unsigned  i = 1; i < n; i++) {
+      if(buf[i-1] == -buf[i])  return;
+    }
+    f(buf, buf+n);
+  };
+  for(GateDef const &def : m_gatedefs)  gateClauses(def, out);
+}
+
+template<typename F>
+void Root::gateClauses(GateDef const &def, F &&out) {
+  int      const  y = def.y;
+  GateKey  const &k = def.key;
+  switch(k.op) {
+  case GateKey::Op::AND:
+    if(def.pol & GateDef::POS) {
+      out({-y,  k.a});
+      out({-y,  k.b});
+    }
+    if(def.pol & GateDef::NEG)  out({ y, -k.a, -k.b});
+    break;
+
+  case GateKey::Op::XOR:
+    if(def.pol & GateDef::POS) {
+      out({-y, -k.a, -k.b});
+      out({-y,  k.a,  k.b});
+    }
+    if(def.pol & GateDef::NEG) {
+      out({ y, -k.a,  k.b});
+      out({ y,  k.a, -k.b});
+    }
+    break;
+
+  case GateKey::Op::MUX:
+    if(def.pol & GateDef::POS) {
+      out({-k.a,  k.b, -y});
+      out({ k.a,  k.c, -y});
+    }
+    if(def.pol & GateDef::NEG) {
+      out({-k.a, -k.b,  y});
+      out({ k.a, -k.c,  y});
+    }
+    break;
   }
 }
 
+void Root::dumpClauses(std::ostream &out) const {
+  forEachClause([&out](int const *beg, int const *end) {
+      while(beg < end)  out << Lit(*beg++) << ' ';
+      out << std::endl;
+    });
+}
+
 std::function<int(int)> Root::varCompactor() const {
   // Compute displacements to compact range of variables
   int const  delta_input  =  FIRST_INPUT  - m_confignxt;
@@ -148,73 +911,825 @@ std::function<int(int)> Root::varCompactor() const {
   };
 }
 
+void Root::emit(ClauseSink &sink) const {
+  unsigned long  clauses = m_clauses.size();
+  forEachGateClause([&clauses](int const*, int const*) { clauses++; });
+  sink.prefix(m_confignxt-FIRST_CONFIG, m_inputnxt-FIRST_INPUT, m_signalnxt-FIRST_SIGNAL, clauses);
+
+  auto const        compact = varCompactor();
+  std::vector<int>  buf;
+  forEachClause([&sink, &compact, &buf](int const *beg, int const *end) {
+      buf.clear();
+      while(beg < end)  buf.push_back(compact(*beg++));
+      sink.clause(buf.data(), buf.data()+buf.size());
+    });
+}
+
+void Root::preprocess() {
+  Preprocessor  pre;
+  emit(pre);
+  m_clauses.clear();
+  std::vector<GateDef>().swap(m_gatedefs);
+  pre.run(); // a false formula is left with the empty clause
+
+  // Map the compacted Variables back into their Ranges
+  unsigned const    configs = m_confignxt - FIRST_CONFIG;
+  unsigned const    inputs  = m_inputnxt  - FIRST_INPUT;
+  std::vector<int>  buf;
+  pre.forEach([this, configs, inputs, &buf](int const *beg, int const *end) {
+      buf.clear();
+      while(beg < end) {
+	int const  lit = *beg++;
+	int        v   = std::abs(lit);
+	if(v <= (int)configs)  v += FIRST_CONFIG-1;
+	else if(v <= (int)(configs+inputs))  v += FIRST_INPUT - configs - 1;
+	else  v += FIRST_SIGNAL - configs - inputs - 1;
+	buf.push_back(lit < 0? -v : v);
+      }
+      m_clauses.add(buf.data(), buf.data()+buf.size());
+    });
+  m_signalnxt = FIRST_SIGNAL + pre.signals();
+
+  Preprocessor::Stats const &stats = pre.stats();
+  std::cout << "Preprocessed into " << m_clauses.size() << " clauses: "
+	    << stats.units        << " unit(s), "
+	    << stats.equivalences << " equivalence(s), "
+	    << stats.subsumed     << " subsumed, "
+	    << stats.strengthened << " strengthened, "
+	    << stats.reduced      << " reduced, "
+	    << stats.eliminated   << " eliminated, "
+	    << stats.blocked      << " blocked" << std::endl;
+}
+
 void Root::dumpQDimacs(std::ostream &out) const {
-  auto const  compact = varCompactor();
+  // Ouput Header
+  out <<
+    "c Generated by QBM [https://github.com/preusser/qbm]\n"
+    "c   by Thomas B. Preusser <thomas.preusser@utexas.edu>\n";
+
+  QDimacsWriter  writer(out);
+  emit(writer);
+  out.flush();
+}
+
+void Root::dumpDimacs(std::ostream &out) const {
+  qbm::Expansion              q;
+  SolverSink<qbm::Expansion>  sink(q);
+  emit(sink);
 
   // Ouput Header
   out <<
     "c Generated by QBM [https://github.com/preusser/qbm]\n"
     "c   by Thomas B. Preusser <thomas.preusser@utexas.edu>\n"
-    "p cnf " << compact(m_signalnxt-1) << ' ' << std::count(m_clauses.begin(), m_clauses.end(), 0) << std::endl;
+    "c Universal expansion with configuration variables 1.." << (m_confignxt-FIRST_CONFIG) << std::endl;
+  q.dump(out);
+}
 
-  // Existential: Configuration
-  out << "e ";
-  for(int  i = FIRST_CONFIG; i < m_confignxt; i++)  out << compact(i) << ' ';
-  out << '0' << std::endl;
+namespace {
+  /** Interval in which running engines are checked against their budget. */
+  std::chrono::milliseconds const  POLL(20);
 
-  // Universal: Inputs
-  out << "a ";
-  for(int  i = FIRST_INPUT; i < m_inputnxt; i++)  out << compact(i) << ' ';
-  out << '0' << std::endl;
+  /** Engine runs in detached threads that have not finished yet. */
+  std::atomic<unsigned>  unfinished(0);
 
-  // Existential: Internal and Output Signals
-  out << "e ";
-  for(int  i = FIRST_SIGNAL; i < m_signalnxt; i++)  out << compact(i) << ' ';
-  out << '0' << std::endl;
+  /** Interrupts the engine and tells whether it will stop shortly. */
+  bool interrupt(qbm::Formula &q) { q.interrupt(); return  true; }
+  bool interrupt(qbm::External &q) { q.interrupt(); return  true; }
+  bool interrupt(qbm::Quantor&)   { return  false; } // not supported by Quantor
 
-  // Clauses
-  for(int lit : m_clauses) {
-    if(lit)  out << compact(lit) << ' ';
-    else     out << '0' << std::endl;
+  /** Streams the formula into the engine. */
+  template<typename Solver>
+  void feed(Root const &root, Solver &q) {
+    SolverSink<Solver>  sink(q);
+    root.emit(sink);
+  }
+  void feed(Root const &root, qbm::External &q) { root.emit(q); }
+
+  /** Outcome of a supervised engine run, which may outlive the Root. */
+  struct Run {
+    std::mutex               mtx;
+    std::condition_variable  cv;
+    bool                     done;
+    Result                   res;
+
+    Run() : done(false) {}
+  };
+
+  /**
+   * Runs the engine in a separate thread until it finishes or exhausts
+   * the budget. Engines that cannot be interrupted are left running
+   * detached in the background.
+   */
+  template<typename Solver>
+  Result supervise(std::shared_ptr<Solver> const &q, qbm::Budget const &budget) {
+    if(budget.unlimited())  return  q->sat();
+
+    std::shared_ptr<Run> const  run = std::make_shared<Run>();
+    unfinished++;
+    std::thread([](std::shared_ptr<Solver> q, std::shared_ptr<Run> run) {
+	Result const  res = q->sat();
+	{
+	  std::lock_guard<std::mutex>  lock(run->mtx);
+	  run->done = true;
+	  run->res  = res;
+	  run->cv.notify_all();
+	}
+	q.reset();
+	run.reset();
+	unfinished--;
+      }, q, run).detach();
+
+    std::unique_lock<std::mutex>  lock(run->mtx);
+    while(!run->cv.wait_for(lock, POLL, [&run]() { return  run->done; })) {
+      Result const  res = budget.exhausted();
+      if(res != QUANTOR_RESULT_UNKNOWN) {
+	if(interrupt(*q))  run->cv.wait(lock, [&run]() { return  run->done; });
+	return  res;
+      }
+    }
+    return  run->res;
   }
-  out.flush();
 }
 
-Result Root::solve() {
-  if(m_res != QUANTOR_RESULT_UNKNOWN)  return  m_res;
+template<typename Solver>
+Result Root::solve(std::shared_ptr<Solver> const &q, qbm::Budget const &budget) {
+  feed(*this, *q);
+  m_clauses.clear();
+  std::vector<GateDef>().swap(m_gatedefs);
+
+  m_res = supervise(q, budget);
+  if(m_res)  adopt(q->assignment());
+  return  m_res;
+}
+
+void Root::adopt(int const *asgn) {
+  // Keep the satisfied configs for resolve()
+  m_solution.clear();
+  while(true) {
+    int const  v = *asgn++;
+    if(v == 0)  break;
+    if(v > 0)  m_solution.push_back(v+1);
+  }
+  std::sort(m_solution.begin(), m_solution.end());
+}
+
+template<typename Solver>
+void Root::solveBatch(std::shared_ptr<Solver> const &q, qbm::Budget const &budget,
+		      std::function<void(unsigned, Result)> const &report) {
+  feed(*this, *q);
+  m_clauses.clear();
+  std::vector<GateDef>().swap(m_gatedefs);
+
+  // Activation variables are configs: shifted by one when compacted
+  for(unsigned  k = 0; k < m_targets.size(); k++) {
+    m_res = budget.exhausted();
+    if(m_res == QUANTOR_RESULT_UNKNOWN) {
+      for(unsigned  j = 0; j < m_targets.size(); j++) {
+	int const  v = m_targets[j] - 1;
+	q->assume(j == k? v : -v);
+      }
+      m_res = supervise(q, budget);
+    }
+    if(m_res)  adopt(q->assignment());
+    report(k, m_res);
+  }
+}
+
+namespace {
+  /** Shared state of a portfolio race, which may outlive the Root. */
+  struct Race {
+    std::mutex               mtx;
+    std::condition_variable  cv;
+    unsigned                 fed;     // contestants done with the formula
+    unsigned                 running; // contestants still solving
+    bool                     decided; // definitive result available
+    Result                   res;
+    std::string              winner;
+    std::vector<int>         assignment;
+    std::vector<std::function<void()>>  interrupts;
+
+    Race(unsigned  n) : fed(0), running(n), decided(false) {}
+  };
+
+  template<typename Solver>
+  void compete(Root const &root, std::shared_ptr<Race> const &race,
+	       std::shared_ptr<Solver> const &q, std::string const &name) {
+    {
+      std::lock_guard<std::mutex>  lock(race->mtx);
+      race->interrupts.emplace_back([q]() { interrupt(*q); });
+    }
+    unfinished++;
+    std::thread([&root, name](std::shared_ptr<Race> race, std::shared_ptr<Solver> q) {
+	{ // Root is guaranteed to exist until all contestants are fed
+	  feed(root, *q);
+	  std::lock_guard<std::mutex>  lock(race->mtx);
+	  race->fed++;
+	  race->cv.notify_all();
+	}
+
+	Result const  res = q->sat();
+	{
+	  std::lock_guard<std::mutex>  lock(race->mtx);
+	  race->running--;
+	  if(!race->decided) {
+	    ::QuantorResult const  r = res;
+	    race->decided = (r == QUANTOR_RESULT_SATISFIABLE) || (r == QUANTOR_RESULT_UNSATISFIABLE);
+	    if(race->decided || (race->res == QUANTOR_RESULT_UNKNOWN)) {
+	      race->res    = res;
+	      race->winner = name;
+	      race->assignment.clear();
+	      if(res) {
+		for(int const *asgn = q->assignment(); *asgn; asgn++)  race->assignment.push_back(*asgn);
+	      }
+	    }
+	    if(race->decided) {
+	      for(auto const &f : race->interrupts)  f();
+	    }
+	  }
+	  race->cv.notify_all();
+	}
+	q.reset();
+	race.reset();
+	unfinished--;
+      }, race, q).detach();
+  }
+}
 
-  auto const  compact = varCompactor();
-  qbm::Quantor  q;
-  std::cout << "using Quantor_" << q.version() << " / " << q.backend() << std::endl;
+unsigned Root::detached() {
+  return  unfinished;
+}
+
+Result Root::solvePortfolio(std::vector<qbm::IpasirLib> const &backends,
+			    qbm::Budget const &budget) {
+  std::vector<qbm::IpasirLib> const  libs = backends.empty()? std::vector<qbm::IpasirLib>(1) : backends;
+  unsigned              const  n    = 1 + 2*libs.size();
+  std::shared_ptr<Race> const  race = std::make_shared<Race>(n);
 
-  q.scope(QUANTOR_EXISTENTIAL_VARIABLE_TYPE);
-  for(int  i = FIRST_CONFIG; i < m_confignxt; i++)  q.add(compact(i));
-  q.add(0);
+  std::cout << "using portfolio of";
+  {
+    auto        const  q    = std::make_shared<qbm::Quantor>();
+    std::string const  name = std::string("Quantor_") + q->version() + " / " + q->backend();
+    std::cout << "\n  " << name;
+    compete(*this, race, q, name);
+  }
+  for(qbm::IpasirLib const &lib : libs) {
+    auto        const  c     = std::make_shared<qbm::Cegar>(lib);
+    std::string const  cname = std::string(c->version()) + " / " + c->backend();
+    std::cout << "\n  " << cname;
+    compete(*this, race, c, cname);
 
-  q.scope(QUANTOR_UNIVERSAL_VARIABLE_TYPE);
-  for(int  i = FIRST_INPUT; i < m_inputnxt; i++)  q.add(compact(i));
-  q.add(0);
+    auto        const  e     = std::make_shared<qbm::Expansion>(lib);
+    std::string const  ename = std::string(e->version()) + " / " + e->backend();
+    std::cout << "\n  " << ename;
+    compete(*this, race, e, ename);
+  }
+  std::cout << std::endl;
 
-  q.scope(QUANTOR_EXISTENTIAL_VARIABLE_TYPE);
-  for(int  i = FIRST_SIGNAL; i < m_signalnxt; i++)  q.add(compact(i));
-  q.add(0);
+  // Await the first definitive result: Quantor cannot be interrupted
+  //   so that it may be left running detached in the background
+  std::unique_lock<std::mutex>  lock(race->mtx);
+  race->cv.wait(lock, [&race, n]() { return  race->fed == n; });
+  Result  exhausted;
+  while(!race->cv.wait_for(lock, POLL, [&race]() {
+	return  race->decided || (race->running == 0);
+      })) {
+    exhausted = budget.exhausted();
+    if(exhausted != QUANTOR_RESULT_UNKNOWN) {
+      for(auto const &f : race->interrupts)  f();
+      race->res = exhausted;
+      race->assignment.clear();
+      break;
+    }
+  }
+  if(exhausted == QUANTOR_RESULT_UNKNOWN)  std::cout << "won by " << race->winner << std::endl;
 
-  for(int lit : m_clauses) q.add(lit? compact(lit) : 0);
   m_clauses.clear();
+  std::vector<GateDef>().swap(m_gatedefs);
+  m_res = race->res;
+  race->assignment.push_back(0);
+  adopt(race->assignment.data());
+  return  m_res;
+}
+
+Result Root::solve(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+		   qbm::Budget const &budget) {
+  if(m_res != QUANTOR_RESULT_UNKNOWN)  return  m_res;
+
+  qbm::IpasirLib const  lib = backends.empty()? qbm::IpasirLib() : backends.front();
+
+  switch(engine) {
+  case Engine::QUANTOR: {
+    auto const  q = std::make_shared<qbm::Quantor>();
+    std::cout << "using Quantor_" << q->version() << " / " << q->backend() << std::endl;
+    return  solve(q, budget);
+  }
+  case Engine::CEGAR: {
+    auto const  q = std::make_shared<qbm::Cegar>(lib);
+    std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+    Result const  res = solve(q, budget);
+    std::cout << "after " << q->iterations() << " counterexample(s)" << std::endl;
+    return  res;
+  }
+  case Engine::EXPANSION: {
+    auto const  q = std::make_shared<qbm::Expansion>(lib);
+    std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+    return  solve(q, budget);
+  }
+  case Engine::PORTFOLIO:
+    return  solvePortfolio(backends, budget);
+  }
+  return  m_res;
+}
+
+Result Root::solve(std::string const &command, qbm::Budget const &budget) {
+  if(m_res != QUANTOR_RESULT_UNKNOWN)  return  m_res;
+
+  auto const  q = std::make_shared<qbm::External>(command);
+  std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+  return  solve(q, budget);
+}
+
+std::vector<int> Root::splitters(unsigned const  count) const {
+  // Configs named in the scope tree
+  class Collector : public Scope::Visitor {
+    std::vector<bool> &m_named;
+
+  public:
+    Collector(std::vector<bool> &named) : m_named(named) {}
+    ~Collector() {}
+
+  public:
+    void visitConfig(std::string const&, Bus const &bus) {
+      for(unsigned  j = 0; j < bus.width(); j++) {
+	int const  v = bus[j];
+	if((FIRST_CONFIG <= v) && (v < FIRST_INPUT))  m_named[v-FIRST_CONFIG] = true;
+      }
+    }
+    void visitChild(std::string const&, Scope const &child) {
+      child.accept(*this);
+    }
+  };
+  std::vector<bool>  named(m_confignxt-FIRST_CONFIG, false);
+  Collector  col(named);
+  m_top.accept(col);
+
+  // Rank them by their references
+  std::vector<unsigned long>  refs(named.size(), 0);
+  forEachClause([this, &refs](int const *beg, int const *end) {
+      while(beg < end) {
+	int const  v = std::abs(*beg++);
+	if(v < m_confignxt)  refs[v-FIRST_CONFIG]++;
+      }
+    });
+  std::vector<int>  vars;
+  for(unsigned  i = 0; i < named.size(); i++) {
+    if(named[i] && (refs[i] > 0))  vars.push_back(i+FIRST_CONFIG);
+  }
+  std::stable_sort(vars.begin(), vars.end(), [&refs](int  a, int  b) {
+      return  refs[a-FIRST_CONFIG] > refs[b-FIRST_CONFIG];
+    });
+  if(vars.size() > count)  vars.resize(count);
+  for(int &v : vars)  v--; // compacted
+  return  vars;
+}
+
+namespace {
+  /** Minimum time a cube runs before it may be split to feed idle threads. */
+  std::chrono::milliseconds const  SLICE(500);
+
+  /** Shared state of the cube-and-conquer threads. */
+  struct Conquest {
+    /** A worker thread with the cube it is solving. */
+    struct Slot {
+      std::deque<std::vector<int>>  queue; // own pending cubes
+      std::vector<int>              cube;
+      bool                          busy;
+      bool                          split; // interrupted for re-splitting
+      std::chrono::steady_clock::time_point  since;
+
+      Slot() : busy(false), split(false) {}
+    };
+
+    std::mutex               mtx;
+    std::condition_variable  cv;
+    std::vector<Slot>        slots;
+    unsigned                 fed;     // workers done with the formula
+    unsigned long            pending; // cubes in all queues
+    unsigned                 busy;    // workers solving a cube
+    bool                     decided;
+    Result                   res;
+    std::vector<int>         assignment;
+    unsigned long            refuted;
+    unsigned long            resplit;
+
+    Conquest(unsigned  n)
+      : slots(n), fed(0), pending(0), busy(0), decided(false), refuted(0), resplit(0) {}
+  };
+}
+
+template<typename Solver>
+Result Root::solveCubes(std::vector<std::shared_ptr<Solver>> const &workers,
+			std::vector<int> const &vars, unsigned const  depth,
+			qbm::Budget const &budget) {
+  unsigned const  n = workers.size();
+  Conquest        st(n);
 
-  m_res = q.sat();
-  if(m_res) {
-    int const *asgn = q.assignment();
+  // Deal the initial cubes round robin
+  for(unsigned long  k = 0; k < (1ul << depth); k++) {
+    std::vector<int>  cube;
+    for(unsigned  i = 0; i < depth; i++)  cube.push_back((k >> i) & 1? vars[i] : -vars[i]);
+    st.slots[k % n].queue.push_back(std::move(cube));
+  }
+  st.pending = 1ul << depth;
+
+  auto const  decide = [&st, &workers](Result const  res) {
+    st.decided = true;
+    st.res     = res;
+    for(auto const &q : workers)  q->interrupt();
+    st.cv.notify_all();
+  };
+  auto const  work = [this, &st, &workers, &vars, &decide, n](unsigned const  w) {
+    Solver &q = *workers[w];
+    feed(*this, q);
+
+    std::unique_lock<std::mutex>  lock(st.mtx);
+    st.fed++;
+    st.cv.notify_all();
+
+    Conquest::Slot &slot = st.slots[w];
     while(true) {
-      int const  v = *asgn++;
-      if(v == 0)  break;
-      if(v > 0)  m_clauses.push_back(v+1);
+      st.cv.wait(lock, [&st]() { return  st.decided || (st.pending > 0); });
+      if(st.decided)  return;
+
+      // Own cubes depth first, stolen ones breadth first
+      if(!slot.queue.empty()) {
+	slot.cube = std::move(slot.queue.back());
+	slot.queue.pop_back();
+      }
+      else {
+	for(unsigned  k = 1; k < n; k++) {
+	  auto &victim = st.slots[(w+k) % n].queue;
+	  if(!victim.empty()) {
+	    slot.cube = std::move(victim.front());
+	    victim.pop_front();
+	    break;
+	  }
+	}
+      }
+      st.pending--;
+      st.busy++;
+      slot.busy  = true;
+      slot.split = false;
+      slot.since = std::chrono::steady_clock::now();
+      q.resume();
+      for(int  lit : slot.cube)  q.assume(lit);
+
+      lock.unlock();
+      Result const  res = q.sat();
+      lock.lock();
+
+      st.busy--;
+      slot.busy = false;
+      if(st.decided)  return;
+
+      ::QuantorResult const  r = res;
+      if(r == QUANTOR_RESULT_SATISFIABLE) {
+	for(int const *asgn = q.assignment(); *asgn; asgn++)  st.assignment.push_back(*asgn);
+	st.assignment.push_back(0);
+	decide(res);
+      }
+      else if(r == QUANTOR_RESULT_UNSATISFIABLE) {
+	st.refuted++;
+	if((st.pending == 0) && (st.busy == 0))  decide(res);
+      }
+      else if(slot.split) {
+	// Hand both halves over to this and idle threads
+	int const  v = vars[slot.cube.size()];
+	slot.cube.push_back(v);
+	slot.queue.push_back(slot.cube);
+	slot.cube.back() = -v;
+	slot.queue.push_back(slot.cube);
+	st.pending += 2;
+	st.resplit++;
+	st.cv.notify_all();
+      }
+      else  decide(res); // engine gave up
+    }
+  };
+
+  std::vector<std::thread>  threads;
+  for(unsigned  w = 0; w < n; w++)  threads.emplace_back(work, w);
+  {
+    std::unique_lock<std::mutex>  lock(st.mtx);
+    st.cv.wait(lock, [&st, n]() { return  st.fed == n; });
+    m_clauses.clear();
+    std::vector<GateDef>().swap(m_gatedefs);
+
+    while(!st.cv.wait_for(lock, POLL, [&st]() { return  st.decided; })) {
+      Result const  exhausted = budget.exhausted();
+      if(exhausted != QUANTOR_RESULT_UNKNOWN) {
+	decide(exhausted);
+	break;
+      }
+
+      // Split the longest running cube while threads are idle
+      if((st.pending == 0) && (st.busy < n)) {
+	auto const  now = std::chrono::steady_clock::now();
+	int  longest = -1;
+	for(unsigned  w = 0; w < n; w++) {
+	  Conquest::Slot const &s = st.slots[w];
+	  if(s.busy && !s.split && (s.cube.size() < vars.size()) && (now - s.since >= SLICE) &&
+	     ((longest < 0) || (s.since < st.slots[longest].since)))  longest = w;
+	}
+	if(longest >= 0) {
+	  st.slots[longest].split = true;
+	  workers[longest]->interrupt();
+	}
+      }
     }
-    std::sort(m_clauses.begin(), m_clauses.end());
   }
+  for(std::thread &t : threads)  t.join();
+
+  std::cout << "after " << st.refuted << " refuted cube(s) and " << st.resplit << " split(s)" << std::endl;
+  m_res = st.res;
+  if(m_res)  adopt(st.assignment.data());
   return  m_res;
 }
 
+Result Root::solveCubes(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+			qbm::Budget const &budget, unsigned  threads, unsigned  depth) {
+  if(m_res != QUANTOR_RESULT_UNKNOWN)  return  m_res;
+  if(threads == 0)  threads = std::max(1u, std::thread::hardware_concurrency());
+  if(depth == 0) {
+    // At least four cubes for each thread
+    while((1ul << depth) < 4ul*threads)  depth++;
+  }
+
+  std::vector<int> const  vars = splitters(depth + RESPLIT);
+  depth = std::min<unsigned>(depth, vars.size());
+  std::cout << (1ul << depth) << " cube(s) over " << depth << " of "
+	    << vars.size() << " splitting config bit(s) on " << threads << " thread(s)" << std::endl;
+
+  qbm::IpasirLib const  lib = backends.empty()? qbm::IpasirLib() : backends.front();
+  switch(engine) {
+  case Engine::CEGAR: {
+    std::vector<std::shared_ptr<qbm::Cegar>>  workers;
+    for(unsigned  w = 0; w < threads; w++)  workers.push_back(std::make_shared<qbm::Cegar>(lib));
+    std::cout << "using " << workers[0]->version() << " / " << workers[0]->backend() << std::endl;
+    Result const  res = solveCubes(workers, vars, depth, budget);
+    unsigned long  iterations = 0;
+    for(auto const &q : workers)  iterations += q->iterations();
+    std::cout << "after " << iterations << " counterexample(s)" << std::endl;
+    return  res;
+  }
+  case Engine::EXPANSION: {
+    std::vector<std::shared_ptr<qbm::Expansion>>  workers;
+    for(unsigned  w = 0; w < threads; w++)  workers.push_back(std::make_shared<qbm::Expansion>(lib));
+    std::cout << "using " << workers[0]->version() << " / " << workers[0]->backend() << std::endl;
+    return  solveCubes(workers, vars, depth, budget);
+  }
+  default:
+    throw "Cube and conquer requires an incremental engine: cegar or expand.";
+  }
+}
+
+template<typename Solver>
+Result Root::enumerate(std::shared_ptr<Solver> const &q, std::vector<int> const &vars,
+		       unsigned long  limit, qbm::Budget const &budget,
+		       std::function<void(unsigned long)> const &report) {
+  feed(*this, *q);
+  m_clauses.clear();
+  std::vector<GateDef>().swap(m_gatedefs);
+
+  std::vector<int>  block;
+  for(unsigned long  n = 1;; n++) {
+    Result  res = budget.exhausted();
+    if(res == QUANTOR_RESULT_UNKNOWN)  res = supervise(q, budget);
+    if(!res)  return  res;
+
+    adopt(q->assignment());
+    report(n);
+    if(n == limit)  return  res;
+
+    // Exclude the projection of this configuration
+    block.clear();
+    for(int  v : vars)  block.push_back(resolve(v+1)? -v : v);
+    q->constrain(block.data(), block.data()+block.size());
+  }
+}
+
+template<typename Solver>
+Result Root::optimize(std::shared_ptr<Solver> const &q,
+		      std::vector<std::pair<int, unsigned>> const &weights,
+		      std::vector<int> const &bound, qbm::Budget const &budget,
+		      std::function<void(unsigned long)> const &report) {
+  feed(*this, *q);
+  m_clauses.clear();
+  std::vector<GateDef>().swap(m_gatedefs);
+
+  bool  found = false;
+  while(true) {
+    Result  res = budget.exhausted();
+    if(res == QUANTOR_RESULT_UNKNOWN)  res = supervise(q, budget);
+    if(!res) {
+      // Without a cheaper configuration, the last one is optimal
+      if(found && (res == QUANTOR_RESULT_UNSATISFIABLE))  return  QUANTOR_RESULT_SATISFIABLE;
+      return  res;
+    }
+
+    adopt(q->assignment());
+    unsigned long  cost = 0;
+    for(auto const &w : weights) {
+      if(resolve(w.first))  cost += w.second;
+    }
+    found = true;
+    report(cost);
+    if(cost == 0)  return  res;
+
+    // Only accept cheaper configurations from now on
+    int const  lit = -(bound[cost-1] - 1);
+    q->constrain(&lit, &lit+1);
+  }
+}
+
+std::vector<int> Root::totalize(std::vector<std::pair<int, unsigned>> const &weights) {
+  // Unary leaves repeating each variable by its weight
+  std::vector<std::vector<int>>  level;
+  for(auto const &w : weights) {
+    if(w.second > 0)  level.emplace_back(w.second, w.first);
+  }
+  if(level.empty())  return  std::vector<int>();
+
+  // Merge pairwise: a_i -> r_i, b_j -> r_j, a_i & b_j -> r_{i+j+1}
+  while(level.size() > 1) {
+    std::vector<std::vector<int>>  next;
+    for(unsigned  k = 0; k+1 < level.size(); k += 2) {
+      std::vector<int> const &a = level[k];
+      std::vector<int> const &b = level[k+1];
+      Bus const  r = allocateConfig(a.size() + b.size());
+      for(unsigned  i = 0; i < a.size(); i++)  addClause({-a[i], r[i]});
+      for(unsigned  j = 0; j < b.size(); j++)  addClause({-b[j], r[j]});
+      for(unsigned  i = 0; i < a.size(); i++) {
+	for(unsigned  j = 0; j < b.size(); j++)  addClause({-a[i], -b[j], r[i+j+1]});
+      }
+      next.emplace_back();
+      for(unsigned  i = 0; i < r.width(); i++)  next.back().push_back(r[i]);
+    }
+    if(level.size() & 1)  next.push_back(std::move(level.back()));
+    level.swap(next);
+  }
+  return  level.front();
+}
+
+Result Root::optimize(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+		      qbm::Budget const &budget, std::vector<Cost> const &costs,
+		      std::function<void(unsigned long)> const &report) {
+  if(m_symmetry == Symmetry::BREAK)  throw "Symmetry breaking may exclude the cheapest configurations.";
+
+  // Accumulate the Weights of the Config Variables
+  std::map<int, unsigned>  weight;
+  if(costs.empty()) {
+    for(int  v = FIRST_CONFIG; v < m_confignxt; v++)  weight[v] = 1;
+  }
+  else {
+    std::vector<std::string>  names;
+    for(Cost const &c : costs)  names.push_back(c.name);
+    std::vector<std::vector<int>> const  vars = select(names);
+    for(unsigned  i = 0; i < costs.size(); i++) {
+      for(int  v : vars[i])  weight[v] += costs[i].weight;
+    }
+  }
+  std::vector<std::pair<int, unsigned>> const  weights(weight.begin(), weight.end());
+
+  unsigned long  total = 0;
+  for(auto const &w : weights)  total += w.second;
+  if(total > MAX_COST)  throw "Total cost too large for the unary bound.";
+  std::vector<int> const  bound = totalize(weights);
+
+  qbm::IpasirLib const  lib = backends.empty()? qbm::IpasirLib() : backends.front();
+  switch(engine) {
+  case Engine::CEGAR: {
+    auto const  q = std::make_shared<qbm::Cegar>(lib);
+    std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+    Result const  res = optimize(q, weights, bound, budget, report);
+    std::cout << "after " << q->iterations() << " counterexample(s)" << std::endl;
+    return  res;
+  }
+  case Engine::EXPANSION: {
+    auto const  q = std::make_shared<qbm::Expansion>(lib);
+    std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+    return  optimize(q, weights, bound, budget, report);
+  }
+  default:
+    throw "Optimization requires an incremental engine: cegar or expand.";
+  }
+}
+
+std::vector<std::vector<int>> Root::select(std::vector<std::string> const &names) const {
+  class Collector : public Scope::Visitor {
+    std::vector<std::string> const &m_names;
+    std::vector<std::vector<int>>  &m_vars;
+    std::string                     m_path;
+
+  public:
+    Collector(std::vector<std::string> const &names, std::vector<std::vector<int>> &vars)
+      : m_names(names), m_vars(vars) {}
+    ~Collector() {}
+
+  public:
+    void visitConfig(std::string const &name, Bus const &bus) {
+      std::string const  path = m_path + name;
+      for(unsigned  i = 0; i < m_names.size(); i++) {
+	std::string const &p = m_names[i];
+	if((path == p) || (!p.empty() && (p.back() == '/') && (path.compare(0, p.size(), p) == 0))) {
+	  for(unsigned  j = 0; j < bus.width(); j++) {
+	    int const  v = bus[j];
+	    if((FIRST_CONFIG <= v) && (v < FIRST_INPUT))  m_vars[i].push_back(v);
+	  }
+	}
+      }
+    }
+    void visitChild(std::string const &name, Scope const &child) {
+      std::string const  prev = m_path;
+      m_path += child.name();
+      child.accept(*this);
+      m_path = prev;
+    }
+  };
+
+  std::vector<std::vector<int>>  vars(names.size());
+  Collector  col(names, vars);
+  m_top.accept(col);
+  for(unsigned  i = 0; i < names.size(); i++) {
+    if(vars[i].empty())  throw "Unknown config: " + names[i];
+  }
+  return  vars;
+}
+
+std::vector<int> Root::project(std::vector<std::string> const &projection) const {
+  std::vector<int>  vars;
+  if(projection.empty()) {
+    for(int  v = FIRST_CONFIG; v < m_confignxt; v++)  vars.push_back(v-1);
+    return  vars;
+  }
+  for(std::vector<int> const &sel : select(projection)) {
+    for(int  v : sel)  vars.push_back(v-1);
+  }
+  std::sort(vars.begin(), vars.end());
+  vars.erase(std::unique(vars.begin(), vars.end()), vars.end());
+  return  vars;
+}
+
+Result Root::enumerate(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+		       qbm::Budget const &budget,
+		       std::vector<std::string> const &projection, unsigned long  limit,
+		       std::function<void(unsigned long)> const &report) {
+  if(m_symmetry == Symmetry::BREAK)  throw "Enumeration would only count configurations up to symmetry.";
+  std::vector<int> const  vars = project(projection);
+  qbm::IpasirLib   const  lib  = backends.empty()? qbm::IpasirLib() : backends.front();
+
+  switch(engine) {
+  case Engine::CEGAR: {
+    auto const  q = std::make_shared<qbm::Cegar>(lib);
+    std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+    Result const  res = enumerate(q, vars, limit, budget, report);
+    std::cout << "after " << q->iterations() << " counterexample(s)" << std::endl;
+    return  res;
+  }
+  case Engine::EXPANSION: {
+    auto const  q = std::make_shared<qbm::Expansion>(lib);
+    std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+    return  enumerate(q, vars, limit, budget, report);
+  }
+  default:
+    throw "Enumeration requires an incremental engine: cegar or expand.";
+  }
+}
+
+void Root::solveBatch(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+		      qbm::Budget const &budget,
+		      std::function<void(unsigned, Result)> const &report) {
+  qbm::IpasirLib const  lib = backends.empty()? qbm::IpasirLib() : backends.front();
+
+  switch(engine) {
+  case Engine::CEGAR: {
+    auto const  q = std::make_shared<qbm::Cegar>(lib);
+    std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+    solveBatch(q, budget, report);
+    std::cout << "after " << q->iterations() << " counterexample(s)" << std::endl;
+    return;
+  }
+  case Engine::EXPANSION: {
+    auto const  q = std::make_shared<qbm::Expansion>(lib);
+    std::cout << "using " << q->version() << " / " << q->backend() << std::endl;
+    solveBatch(q, budget, report);
+    return;
+  }
+  default:
+    throw "Batch matching requires an incremental engine: cegar or expand.";
+  }
+}
+
 void Root::printConfig(std::ostream &out) const {
   class Printer : public Scope::Visitor {
     Root const   &m_root;
@@ -20,13 +20,23 @@
 #ifndef ROOT_HPP
 #define ROOT_HPP
 
+#include "Budget.hpp"
 #include "Bus.hpp"
+#include "ClauseDB.hpp"
+#include "ClauseSink.hpp"
+#include "Ipasir.hpp"
 #include "Result.hpp"
 #include "Scope.hpp"
+#include "Template.hpp"
 
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 #include <functional>
 #include <algorithm>
+#include <unordered_map>
+#include <initializer_list>
 
 class CompDecl;
 class Root {
@@ -35,38 +45,450 @@ public:
   static int const  FIRST_INPUT  = 0x3FFF0000;
   static int const  FIRST_SIGNAL = 0x40000000;
 
+  /** The splitting bits kept in reserve for re-splitting slow cubes. */
+  static unsigned const  RESPLIT = 8;
+
+  /** The maximum total cost handled by optimize(). */
+  static unsigned long const  MAX_COST = 1ul << 12;
+
+  /** The available solution engines, PORTFOLIO races all others. */
+  enum class Engine { QUANTOR, CEGAR, EXPANSION, PORTFOLIO };
+
+  /**
+   * The available encodings of gates into clauses:
+   *  FULL     - complete Tseitin encoding of all gates
+   *  POLARITY - only the implications needed by the polarities in
+   *             which a gate output is referenced (Plaisted-Greenbaum)
+   */
+  enum class Encoding { FULL, POLARITY };
+
+  /**
+   * The available encodings of CHOOSE<k> selections:
+   *  ENUMERATE - binary numbering of all (n over k) selections
+   *  ORDERED   - one order-encoded offset per output, offsets ascending
+   */
+  enum class Selection { ENUMERATE, ORDERED };
+
+  /**
+   * The available encodings of SEL operations x[s]:
+   *  CLAUSES - two clauses over all selector bits for each line of x
+   *  TREE    - binary tree of 2:1 multiplexer gates
+   *  DECODER - two clauses for each line of x over a shared decoded selector
+   */
+  enum class Multiplex { CLAUSES, TREE, DECODER };
+
+  /**
+   * The treatment of interchangeable instances, which share component,
+   * generics and fan-in and whose single output bits only address the same
+   * LUT-like tables of otherwise unused configs:
+   *  KEEP  - leave their configurations unconstrained
+   *  BREAK - order their configurations lexicographically
+   */
+  enum class Symmetry { KEEP, BREAK };
+
+  /** The cost of each set config bit within the named configs or instances. */
+  struct Cost {
+    std::string  name;
+    unsigned     weight;
+  };
+
+  /** A target function for batch matching: component with its generics. */
+  struct Target {
+    CompDecl const   *decl;
+    std::vector<int>  generics;
+  };
+
+private:
+  /** Key of a gate within the structural hash. */
+  struct GateKey {
+    enum class Op : unsigned char { AND, XOR, MUX };
+    Op   op;
+    int  a, b, c;
+
+    bool operator==(GateKey const &o) const {
+      return (op == o.op) && (a == o.a) && (b == o.b) && (c == o.c);
+    }
+  };
+  /** Gate definition y = op(a, b, c) with the polarities to encode. */
+  struct GateDef {
+    enum : unsigned char { POS = 1, NEG = 2, BOTH = POS|NEG };
+    int            y;
+    GateKey        key;
+    unsigned char  pol;
+  };
+  /** An instance that may be interchangeable with others. */
+  struct Instance {
+    CompDecl const   *decl;
+    std::vector<int>  key;     // generics followed by the fan-in
+    int               output;
+    unsigned          usebeg, useend;  // own range of m_uses
+    int               cfgbeg, cfgend;  // own configs
+  };
+  /** A table read c[x] from a config bus c of 2**|x| lines. */
+  struct Table {
+    std::vector<int>  lines;
+    std::vector<int>  address;
+  };
+  struct GateHash {
+    size_t operator()(GateKey const &k) const {
+      size_t  h = (size_t)k.op;
+      h = 31*h + (unsigned)k.a;
+      h = 31*h + (unsigned)k.b;
+      h = 31*h + (unsigned)k.c;
+      return  h;
+    }
+  };
+
 private:
   Scope  m_top;
 
-  std::vector<int>  m_clauses;
+  ClauseDB          m_clauses;
+  std::vector<int>  m_clause;  // being added
   int  m_confignxt;
   int  m_inputnxt;
   int  m_signalnxt;
 
-  Result  m_res;
+  Selection  m_selection;
+  Multiplex  m_multiplex;
+
+  std::unordered_map<GateKey, int, GateHash>  m_gates;
+  std::vector<GateDef>                        m_gatedefs; // by allocation
+  std::vector<int>                            m_aliases;  // signal -> literal
+  std::map<std::vector<int>, std::vector<int>>  m_decoders; // selector -> minterms
+  std::vector<int>                            m_targets;  // activation config by target
+
+  Symmetry               m_symmetry;
+  bool                   m_recording; // uses of nodes
+  unsigned               m_muted;     // nesting of Mute guards
+  std::vector<int>       m_uses;      // nodes used other than as table address
+  std::vector<Table>     m_tables;
+  std::vector<Instance>  m_instances;
+
+  /** Component, generics, port widths and signature. */
+  typedef std::pair<CompDecl const*, std::vector<int>>  TemplateKey;
+  std::map<TemplateKey, std::unique_ptr<Template>>  m_templates;
+  std::vector<std::pair<TemplateKey, std::unique_ptr<Template>>>  m_tapes; // being recorded
+
+  /** An instance whose elaboration is deferred. */
+  struct Deferred {
+    Scope            *scope;
+    std::string       label;
+    CompDecl const   *decl;
+    std::vector<int>  generics;
+    std::vector<Bus>  ports;
+    TemplateKey       key;
+  };
+  unsigned               m_threads;
+  bool                   m_scratch;   // only recording a template
+  bool                   m_deferring; // instances of the top level
+  std::vector<Deferred>  m_deferred;
+
+  Result            m_res;
+  std::vector<int>  m_solution; // sorted configs set by the adopted assignment
 
 public:
-  Root(CompDecl const &decl, std::vector<int> const &generics);
+  Root(CompDecl const &decl, std::vector<int> const &generics,
+       Encoding   encoding  = Encoding::FULL,
+       Selection  selection = Selection::ENUMERATE,
+       Multiplex  multiplex = Multiplex::CLAUSES,
+       Symmetry   symmetry  = Symmetry::KEEP,
+       unsigned   threads   = 0)
+    : Root(decl, generics, std::vector<Target>(), encoding, selection, multiplex, symmetry, threads) {}
+
+  /**
+   * Elaborates the given structure together with target functions sharing
+   * its ports. The structure outputs are only bound to the outputs of a
+   * target while its activation config variable is set so that solveBatch()
+   * can match one target after the other.
+   * The instances of the top level are elaborated by the given number of
+   * threads, 0 for the hardware concurrency. The formula is the same for
+   * any number of threads.
+   */
+  Root(CompDecl const &decl, std::vector<int> const &generics,
+       std::vector<Target> const &targets,
+       Encoding   encoding  = Encoding::FULL,
+       Selection  selection = Selection::ENUMERATE,
+       Multiplex  multiplex = Multiplex::CLAUSES,
+       Symmetry   symmetry  = Symmetry::KEEP,
+       unsigned   threads   = 0);
   ~Root() {}
+private:
+  /** An empty scratch root for recording templates. */
+  Root(Selection  selection, Multiplex  multiplex);
+
+public:
+  bool verbose() const { return !m_scratch; }
+  Selection selection() const { return  m_selection; }
+  Multiplex multiplex() const { return  m_multiplex; }
 
 public:
   Bus allocateConfig(unsigned  width);
   Bus allocateInput (unsigned  width);
   Bus allocateSignal(unsigned  width);
 
+  //- Gates with Structural Hashing
+public:
+  Node gateAnd(Node  a, Node  b);
+  Node gateOr (Node  a, Node  b) { return -gateAnd(-a, -b); }
+  Node gateXor(Node  a, Node  b);
+  Node gateMux(Node  s, Node  a, Node  b); // s? a : b
+
+  /**
+   * Returns the 2**width minterms over the given selector bits with
+   * bit i of the index corresponding to sel[i]. The minterms are only
+   * built once for each selector.
+   */
+  std::vector<int> const& decode(Bus const &sel, unsigned  width);
+private:
+  int gate(GateKey const &key);
+
+  //- Symmetry Breaking
+public:
+  /** Suspends the recording of node uses while alive. */
+  class Mute {
+    Root &m_root;
+  public:
+    Mute(Root &root) : m_root(root) { m_root.m_muted++; }
+    ~Mute() { m_root.m_muted--; }
+  };
+
+  /**
+   * Records the table read lhs[rhs] if lhs is a complete table of distinct
+   * configs. Its encoding should then be built under a Mute guard.
+   * @return whether the table read was recorded
+   */
+  bool readTable(Bus const &lhs, Bus const &rhs);
+
+  /** Opens the record of an instance being compiled. */
+  unsigned enterInstance(CompDecl const &decl, std::vector<int> const &generics,
+			 std::vector<Bus> const &inputs, std::vector<Bus> const &outputs);
+  /** Closes the record of the instance returned by enterInstance(). */
+  void leaveInstance(unsigned  id);
+private:
+  void use(int const  lit) {
+    if(m_recording && (m_muted == 0))  m_uses.push_back(std::abs(lit));
+  }
+  void breakSymmetries();
+
+  //- Component Templates
+public:
+  /**
+   * Returns the template recorded for an instance of the component with
+   * these generics and ports or nullptr after starting to record one,
+   * which endTemplate() completes after the instance has been compiled.
+   * Templates are not used while symmetry breaking needs to observe the
+   * compilation of each instance.
+   */
+  Template const* beginTemplate(CompDecl const &decl, std::vector<int> const &generics,
+				std::vector<Bus> const &ports);
+  /** Completes the recording with the configs registered in the scope. */
+  void endTemplate(Scope const &scope);
+
+  /**
+   * Defers the elaboration of an instance of the top level into a child of
+   * the given scope if possible. The templates of the distinct deferred
+   * instances are then recorded in parallel within scratch roots, each with
+   * its own variables and clauses. They are replayed in the order of
+   * instantiation so that the formula does not depend on the threads.
+   * @return whether the elaboration has been deferred
+   */
+  bool defer(Scope &scope, std::string const &label, CompDecl const &decl,
+	     std::vector<int> const &generics, std::vector<Bus> const &ports);
+
+  /**
+   * Record an operation within all templates being recorded: trace()
+   * with its operands before it is executed, traced() with its results.
+   */
+  void trace(Template::Op  op, int const *beg, int const *end) {
+    if(!m_tapes.empty())  recordStep(op, beg, end);
+  }
+  void trace(Template::Op  op, std::initializer_list<int> const  args) {
+    trace(op, args.begin(), args.end());
+  }
+  Node traced(Node  y) {
+    if(!m_tapes.empty()) {
+      int const  lit = y;
+      recordYield(&lit, &lit+1);
+    }
+    return  y;
+  }
+  Bus traced(Bus const &bus);
+  std::vector<int> const& traced(std::vector<int> const &terms) {
+    if(!m_tapes.empty())  recordYield(terms.data(), terms.data()+terms.size());
+    return  terms;
+  }
+private:
+  /** The key of the instance and its port bits as resolved literals. */
+  TemplateKey templateKey(CompDecl const &decl, std::vector<int> const &generics,
+			  std::vector<Bus> const &ports, std::vector<int> &lits);
+  std::unique_ptr<Template> record(Deferred const &inst) const;
+  void elaborateDeferred();
+  void recordStep (Template::Op  op, int const *beg, int const *end);
+  void recordYield(int const *beg, int const *end);
+
+  //- Signal Aliasing
+public:
+  void equate(Node  a, Node  b);
+private:
+  int find(int  lit);
+  void finalize(Encoding  encoding);
+
 public:
   void print(std::ostream &out, Bus const &bus) const;
   void addClause(int const *beg, int const *end);
+  void addClause(std::initializer_list<int> const  clause) {
+    addClause(clause.begin(), clause.end());
+  }
   void dumpClauses(std::ostream &out) const;
 
 private:
   std::function<int(int)> varCompactor() const;
+  template<typename F>      void   forEachClause(F &&f) const;
+  template<typename F>      void   forEachGateClause(F &&f) const;
+  /** The clauses encoding a gate in the polarities it is needed in. */
+  template<typename F>  static void  gateClauses(GateDef const &def, F &&f);
+  void adopt(int const *asgn);
+  template<typename Solver>
+  Result solve(std::shared_ptr<Solver> const &solver, qbm::Budget const &budget);
+  template<typename Solver>
+  void solveBatch(std::shared_ptr<Solver> const &solver, qbm::Budget const &budget,
+		  std::function<void(unsigned, Result)> const &report);
+  template<typename Solver>
+  Result enumerate(std::shared_ptr<Solver> const &solver, std::vector<int> const &vars,
+		   unsigned long  limit, qbm::Budget const &budget,
+		   std::function<void(unsigned long)> const &report);
+  template<typename Solver>
+  Result optimize(std::shared_ptr<Solver> const &solver,
+		  std::vector<std::pair<int, unsigned>> const &weights,
+		  std::vector<int> const &bound, qbm::Budget const &budget,
+		  std::function<void(unsigned long)> const &report);
+  /**
+   * Adds a totalizer over the weighted config variables whose i-th output
+   * config is implied by a total weight above i.
+   */
+  std::vector<int> totalize(std::vector<std::pair<int, unsigned>> const &weights);
+  /**
+   * The config variables of each named config bus or, by a trailing '/',
+   * of each named instance.
+   * @throws std::string if a name does not select any config
+   */
+  std::vector<std::vector<int>> select(std::vector<std::string> const &names) const;
+  /** The compacted config variables selected by the projection. */
+  std::vector<int> project(std::vector<std::string> const &projection) const;
+  Result solvePortfolio(std::vector<qbm::IpasirLib> const &backends,
+			qbm::Budget const &budget);
+  /**
+   * The compacted config variables of the configs in the scope tree that
+   * are referenced most often by the formula, at most count of them.
+   */
+  std::vector<int> splitters(unsigned  count) const;
+  template<typename Solver>
+  Result solveCubes(std::vector<std::shared_ptr<Solver>> const &workers,
+		    std::vector<int> const &vars, unsigned  depth,
+		    qbm::Budget const &budget);
 
 public:
+  /**
+   * Simplifies the formula by the Preprocessor, which keeps its configs and
+   * their implementing values so that printConfig() needs no reconstruction.
+   * The gate clauses are then stored explicitly with all others. Must be
+   * called before solving.
+   */
+  void preprocess();
+
+  /**
+   * Streams the formula into the given sink. The clauses of the gates
+   * are only generated on the fly from their compact definitions.
+   */
+  void emit(ClauseSink &sink) const;
+
   void dumpQDimacs(std::ostream &out) const;
-  Result solve();
+  void dumpDimacs (std::ostream &out) const;
+  /**
+   * Solves the formula by the given engine. The IPASIR-based engines use
+   * the first of the given SAT backends, the linked one if there is none.
+   * The portfolio races them on all of the backends. Quantor always uses
+   * the linked backend.
+   * An engine exhausting the budget yields QUANTOR_RESULT_TIMEOUT or
+   * QUANTOR_RESULT_SPACEOUT. As Quantor cannot be interrupted, it is then
+   * left running detached in the background.
+   */
+  Result solve(Engine  engine = Engine::QUANTOR,
+	       std::vector<qbm::IpasirLib> const &backends = std::vector<qbm::IpasirLib>(),
+	       qbm::Budget const &budget = qbm::Budget());
+  /**
+   * The number of engine runs still going on in detached threads. The
+   * program must then end by quick_exit() lest they run on while the
+   * static objects are destroyed.
+   */
+  static unsigned detached();
+  /**
+   * Solves the formula by the external QBF solver started by the given
+   * shell command. The formula is streamed to the solver in the QDIMACS
+   * format. The configuration is read back from its certificate.
+   */
+  Result solve(std::string const &command, qbm::Budget const &budget = qbm::Budget());
+  /**
+   * Matches the structure against one target after the other by the CEGAR
+   * or the expansion engine on the first of the given SAT backends. The
+   * engine is only fed once and keeps its SAT instances across the targets,
+   * which are selected by assuming their activation variables. The result
+   * of each target is passed to the report function, which may retrieve its
+   * configuration through printConfig().
+   */
+  void solveBatch(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+		  qbm::Budget const &budget,
+		  std::function<void(unsigned, Result)> const &report);
+  /**
+   * Solves the formula by cube and conquer. The 2**depth cubes over the most
+   * often referenced config bits, typically the selectors of multiplexers,
+   * are distributed over the given number of threads. Each thread runs its
+   * own CEGAR or expansion engine on the first of the given SAT backends
+   * and solves cube after cube by assumptions. A thread running out of
+   * cubes steals the oldest pending one from another thread. A cube that
+   * keeps its engine busy for long while other threads are idle is
+   * interrupted and split by another config bit. The first satisfiable
+   * cube decides the formula, which is unsatisfiable if all cubes are.
+   * @param threads  number of worker threads, 0 for the hardware concurrency
+   * @param depth    number of initial splitting bits, 0 for enough cubes
+   *                 to keep all threads busy
+   */
+  Result solveCubes(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+		    qbm::Budget const &budget, unsigned  threads, unsigned  depth);
+  /**
+   * Enumerates the implementing configurations by the CEGAR or the expansion
+   * engine, which excludes each configuration found by a blocking clause.
+   * The blocking clauses only span the configs selected by the projection,
+   * which names config busses like printConfig() or whole instances by a
+   * trailing '/'. All configs are distinguished if it is empty. Each
+   * configuration is passed to the report function with its sequence
+   * number as soon as it is found so that it can be retrieved through
+   * printConfig().
+   * @param limit  the maximum number of configurations, 0 for all
+   * @return QUANTOR_RESULT_UNSATISFIABLE when all configurations have been
+   *         found, QUANTOR_RESULT_SATISFIABLE when the limit was reached or
+   *         the result of the engine giving up otherwise
+   */
+  Result enumerate(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+		   qbm::Budget const &budget,
+		   std::vector<std::string> const &projection, unsigned long  limit,
+		   std::function<void(unsigned long)> const &report);
+  /**
+   * Searches a configuration of minimal total cost by the CEGAR or the
+   * expansion engine. Each configuration found is reported with its cost
+   * and then excluded with all others of the same or higher cost by
+   * tightening a bound on the output of a totalizer over the weighted
+   * config bits. The configs of different costs accumulate their weights.
+   * Without any cost, every config bit weighs one.
+   * @return QUANTOR_RESULT_SATISFIABLE if the last configuration reported
+   *         is optimal, QUANTOR_RESULT_UNSATISFIABLE if there is none or
+   *         the result of the engine giving up otherwise
+   */
+  Result optimize(Engine  engine, std::vector<qbm::IpasirLib> const &backends,
+		  qbm::Budget const &budget, std::vector<Cost> const &costs,
+		  std::function<void(unsigned long)> const &report);
   bool resolve(int const  v) const {
-    return  std::binary_search(m_clauses.begin(), m_clauses.end(), v);
+    return  std::binary_search(m_solution.begin(), m_solution.end(), v);
   }
   void printConfig(std::ostream &out) const;
 };
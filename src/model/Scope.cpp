@@ -29,6 +29,16 @@ Scope &Scope::createChild(std::string const &name) {
   return  res.first->second;
 }
 
+void Scope::copy(Scope const &other, std::function<int(int)> const &map) {
+  for(auto const &e : other.m_configs) {
+    Bus const &bus = e.second;
+    addConfig(e.first, Bus::build(bus.width(), [&bus, &map](unsigned const  i) { return  map(bus[i]); }));
+  }
+  for(auto const &e : other.m_children) {
+    createChild(e.first).copy(e.second, map);
+  }
+}
+
 void Scope::accept(Visitor &v) const {
   for(auto const &e : m_configs) {
     v.visitConfig(e.first, e.second);
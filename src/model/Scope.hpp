@@ -24,6 +24,7 @@
 
 #include <string>
 #include <map>
+#include <functional>
 
 class Scope {
   std::string const             m_name;
@@ -42,6 +43,8 @@ public:
     m_configs.emplace(name, bus);
   }
   Scope &createChild(std::string const &name);
+  /** Adds the configs and children of other with their nodes mapped. */
+  void copy(Scope const &other, std::function<int(int)> const &map);
 
 public:
   class Visitor {
@@ -56,10 +56,7 @@ void Equation::execute(Context &ctx) const {
   Bus const  lhs = ctx.computeBus(*m_lhs);
   Bus const  rhs = ctx.computeBus(*m_rhs);
   for(unsigned  i = std::max(lhs.width(), rhs.width()); i-- > 0;) {
-    int const  a = lhs[i];
-    int const  b = rhs[i];
-    ctx.addClause( a, -b);
-    ctx.addClause(-a,  b);
+    ctx.equate(lhs[i], rhs[i]);
   }
 }
 
@@ -83,21 +80,47 @@ void Instantiation::dump(std::ostream &out) const {
   out << ')';
 }
 void Instantiation::execute(Context &ctx) const {
-  std::map<std::string, int>  params;
+  SymbolMap<int>              params;
+  std::vector<int>            generics;
   { // Compute Generic Parameters
     unsigned const  n = m_params.size();
     if(n != m_decl.countParameters())  throw "Wrong number of parameters.";
-    for(unsigned  i = 0; i < n; i++)  params[m_decl.getParameter(i).name()] = ctx.computeConstant(*m_params[i]);
+    for(unsigned  i = 0; i < n; i++) {
+      generics.push_back(ctx.computeConstant(*m_params[i]));
+      params[m_decl.getParameter(i).name()] = generics.back();
+    }
   }
-  std::map<std::string, Bus>  connects;
+  SymbolMap<Bus>              connects;
+  std::vector<Bus>            ports;
+  std::vector<Bus>            inputs;
+  std::vector<Bus>            outputs;
   { // Compute Generic Parameters
     unsigned const  n = m_connects.size();
     if(n != m_decl.countPorts())  throw "Wrong number of ports.";
     for(unsigned  i = 0; i < n; i++) {
-      connects[m_decl.getPort(i).name()] = ctx.computeBus(*m_connects[i]);
+      PortDecl const &port = m_decl.getPort(i);
+      Bus      const  bus  = ctx.computeBus(*m_connects[i]);
+      connects.emplace(port.name(), bus);
+      ports.push_back(bus);
+      (port.direction() == PortDecl::Direction::in? inputs : outputs).push_back(bus);
     }
   }
-  Context(ctx, m_label + '/', std::move(params), std::move(connects)).compile(m_label, m_decl);
+  Root &root = ctx.root();
+  if(root.defer(ctx.scope(), m_label, m_decl, generics, ports))  return;
+
+  unsigned const  id = root.enterInstance(m_decl, generics, inputs, outputs);
+  Template const *const  tmpl = root.beginTemplate(m_decl, generics, ports);
+  if(tmpl) {
+    // Replay the elaboration of an earlier instance
+    if(root.verbose())  std::cout << "Compiling " << m_label << " : " << m_decl.name() << " from template ..." << std::endl;
+    tmpl->replay(ctx, ctx.scope().createChild(m_label + '/'), ports);
+  }
+  else {
+    Context  inst(ctx, m_label + '/', std::move(params), std::move(connects));
+    inst.compile(m_label, m_decl);
+    root.endTemplate(inst.scope());
+  }
+  root.leaveInstance(id);
 }
 
 Generate::~Generate() {}
@@ -105,12 +128,11 @@ void Generate::execute(Context &ctx) const {
   int const  lo = ctx.computeConstant(*m_lo);
   int const  hi = ctx.computeConstant(*m_hi);
 
-  std::string const& var = m_var;
   for(int  i = lo; i <= hi; i++) {
     std::stringstream  name;
     name << i << '.';
     InnerContext  local(ctx, name.str());
-    local.defineConstant(var, i);
+    local.defineConstant(m_var, i);
     for(std::shared_ptr<Statement const> const& stmt : m_body) {
       stmt->execute(local);
     }
@@ -21,6 +21,7 @@
 #define STATEMENT_HPP
 
 #include "Decl.hpp"
+#include "Symbol.hpp"
 
 #include <vector>
 #include <memory>
@@ -41,24 +42,24 @@ public:
 
 //- Declarations  ------------------------------------------------------------
 class Declaration : public Statement {
-  std::string const                  m_name;
+  Symbol const                       m_name;
   std::shared_ptr<Expression const>  m_expr;
 
 protected:
-  Declaration(std::string                const &name,
+  Declaration(Symbol                     const &name,
 	      std::shared_ptr<Expression const> expr)
     : m_name(name), m_expr(expr) {}
 public:
   ~Declaration() {}
 
 public:
-  std::string const& name() const { return  m_name; }
+  Symbol      const& name() const { return  m_name; }
   Expression  const& expr() const { return *m_expr; }
 };
 
 class ConstDecl : public Declaration {
 public:
-  ConstDecl(std::string const &name, std::shared_ptr<Expression const> value)
+  ConstDecl(Symbol const &name, std::shared_ptr<Expression const> value)
     : Declaration(name, value) {}
   ~ConstDecl();
 
@@ -70,7 +71,7 @@ public:
 
 class ConfigDecl : public Declaration {
 public:
-  ConfigDecl(std::string const &name, std::shared_ptr<Expression const> width)
+  ConfigDecl(Symbol const &name, std::shared_ptr<Expression const> width)
     : Declaration(name, width) {}
   ~ConfigDecl();
 
@@ -82,7 +83,7 @@ public:
 
 class SignalDecl : public Declaration {
 public:
-  SignalDecl(std::string const &name, std::shared_ptr<Expression const> width)
+  SignalDecl(Symbol const &name, std::shared_ptr<Expression const> width)
     : Declaration(name, width) {}
   ~SignalDecl();
 
@@ -157,13 +158,13 @@ public:
 
 //- Generate -----------------------------------------------------------------
 class Generate : public Statement {
-  std::string const                  m_var;
+  Symbol const                       m_var;
   std::shared_ptr<Expression const>  m_lo;
   std::shared_ptr<Expression const>  m_hi;
   std::vector<std::shared_ptr<Statement const>>  m_body;
 
 public:
-  Generate(std::string const                 &var,
+  Generate(Symbol const                      &var,
 	   std::shared_ptr<Expression const>  lo,
 	   std::shared_ptr<Expression const>  hi)
     : m_var(var), m_lo(lo), m_hi(hi) {}
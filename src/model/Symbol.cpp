@@ -0,0 +1,32 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "Symbol.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+Symbol::Entry const& Symbol::intern(std::string const &name) {
+  // The entries of a node-based map keep their addresses upon rehashing.
+  static std::mutex                                 mutex;
+  static std::unordered_map<std::string, unsigned>  table;
+
+  std::lock_guard<std::mutex>  lock(mutex);
+  return *table.emplace(name, table.size()+1).first;
+}
@@ -0,0 +1,118 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef SYMBOL_HPP
+#define SYMBOL_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <ostream>
+
+/**
+ * An identifier interned into a process-wide table. The names are interned
+ * as the syntax tree is built so that the elaboration compares and hashes
+ * them by their numbers rather than by their characters.
+ */
+class Symbol {
+  typedef std::pair<std::string const, unsigned>  Entry;
+  Entry const *m_entry;
+
+public:
+  Symbol(std::string const &name) : m_entry(&intern(name)) {}
+  Symbol(char const *name) : Symbol(std::string(name)) {}
+  ~Symbol() {}
+
+private:
+  static Entry const& intern(std::string const &name);
+
+public:
+  /** The unique number of this symbol, counting from one. */
+  unsigned id() const { return  m_entry->second; }
+  std::string const& str() const { return  m_entry->first; }
+
+  bool operator==(Symbol const &other) const { return  m_entry == other.m_entry; }
+  bool operator!=(Symbol const &other) const { return  m_entry != other.m_entry; }
+};
+inline std::ostream& operator<<(std::ostream &out, Symbol const &sym) {
+  return  out << sym.str();
+}
+
+/**
+ * A flat hash table from symbols to values with open addressing. It probes
+ * linearly from the symbol number and is kept at most half full. Entries
+ * are never removed as the names of an elaboration context stay defined.
+ */
+template<typename T>
+class SymbolMap {
+  std::vector<std::pair<unsigned, T>>  m_slots; // symbol number (0: empty) and value
+  unsigned                             m_size;
+
+public:
+  SymbolMap() : m_size(0) {}
+  ~SymbolMap() {}
+
+private:
+  unsigned probe(unsigned const  id) const {
+    unsigned const  mask = m_slots.size()-1;
+    unsigned        i    = id & mask;
+    while((m_slots[i].first != 0) && (m_slots[i].first != id))  i = (i+1) & mask;
+    return  i;
+  }
+  void grow() {
+    std::vector<std::pair<unsigned, T>>  slots(m_slots.empty()? 8 : 2*m_slots.size());
+    slots.swap(m_slots);
+    for(auto &slot : slots) {
+      if(slot.first != 0)  m_slots[probe(slot.first)] = std::move(slot);
+    }
+  }
+
+public:
+  unsigned size() const { return  m_size; }
+
+  T const* find(Symbol const &key) const {
+    if(m_slots.empty())  return  nullptr;
+    auto const &slot = m_slots[probe(key.id())];
+    return  slot.first != 0? &slot.second : nullptr;
+  }
+  T* find(Symbol const &key) {
+    return  const_cast<T*>(static_cast<SymbolMap const&>(*this).find(key));
+  }
+
+  /** @return whether the key was new and the value has been inserted */
+  bool emplace(Symbol const &key, T const &val) {
+    if(2*(m_size+1) > m_slots.size())  grow();
+    auto &slot = m_slots[probe(key.id())];
+    if(slot.first != 0)  return  false;
+    slot.first  = key.id();
+    slot.second = val;
+    m_size++;
+    return  true;
+  }
+  T& operator[](Symbol const &key) {
+    if(2*(m_size+1) > m_slots.size())  grow();
+    auto &slot = m_slots[probe(key.id())];
+    if(slot.first == 0) {
+      slot.first = key.id();
+      m_size++;
+    }
+    return  slot.second;
+  }
+};
+#endif
@@ -0,0 +1,150 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#include "Template.hpp"
+#include "Context.hpp"
+
+#include <cstdlib>
+
+Template::Template(std::vector<int> const &ports, int const  fresh)
+  : m_slots(ports.size()), m_scope(""), m_op(Op::CLAUSE), m_fresh(fresh), m_valid(true) {
+  for(unsigned  i = 0; i < ports.size(); i++) {
+    int const  lit = ports[i];
+    if((lit != Node::TOP) && (lit != Node::BOT))  m_index.emplace(std::abs(lit), lit < 0? -(i+2) : i+2);
+  }
+}
+Template::~Template() {}
+
+int Template::slot(int const  lit) const {
+  if((lit == Node::TOP) || (lit == Node::BOT))  return  lit;
+  auto const  it = m_index.find(std::abs(lit));
+  if(it == m_index.end())  return  0;
+  return  lit < 0? -it->second : it->second;
+}
+
+void Template::step(Op const  op, int const *beg, int const *end) {
+  if(!m_valid)  return;
+  m_op = op;
+  m_args.assign(beg, end);
+  m_code.push_back(static_cast<int>(op));
+  m_code.push_back(end - beg);
+  for(int  lit : m_args) {
+    if((op == Op::CONFIG) || (op == Op::SIGNAL))  m_code.push_back(lit); // width
+    else {
+      int const  s = slot(lit);
+      if(s == 0) { // not derived from the ports
+	m_valid = false;
+	return;
+      }
+      m_code.push_back(s);
+    }
+  }
+}
+
+void Template::yield(int const *beg, int const *end) {
+  if(!m_valid)  return;
+  while(beg < end) {
+    int const  lit = *beg++;
+    int const  var = std::abs(lit);
+    int const  s   = m_slots++ + 2;
+    if((lit == Node::TOP) || (lit == Node::BOT))  continue;
+
+    switch(m_op) {
+    case Op::AND:
+    case Op::XOR:
+    case Op::MUX:
+      // Gates only yield constants, operands or nodes built inside
+      if(var < m_fresh) {
+	bool  operand = false;
+	for(int  a : m_args)  operand |= std::abs(a) == var;
+	if(!operand) {
+	  m_valid = false;
+	  return;
+	}
+      }
+      break;
+    default:
+      break;
+    }
+    m_index.emplace(var, lit < 0? -s : s);
+  }
+}
+
+void Template::finish(Scope const &scope) {
+  if(m_valid) {
+    m_scope.copy(scope, [this](int const  v) -> int {
+	int const  s = slot(v);
+	if(s == 0)  m_valid = false;
+	return  s;
+      });
+  }
+  std::unordered_map<int, int>().swap(m_index);
+  std::vector<int>().swap(m_args);
+  m_code.shrink_to_fit();
+}
+
+void Template::replay(Context &ctx, Scope &scope, std::vector<Bus> const &ports) const {
+  std::vector<int>  nodes;
+  nodes.reserve(m_slots);
+  for(Bus const &bus : ports) {
+    for(unsigned  i = 0; i < bus.width(); i++)  nodes.push_back(bus[i]);
+  }
+  auto const  node = [&nodes](int const  lit) -> int {
+    if((lit == Node::TOP) || (lit == Node::BOT))  return  lit;
+    int const  v = nodes[std::abs(lit)-2];
+    return  lit < 0? -v : v;
+  };
+
+  std::vector<int>  args;
+  auto  it = m_code.begin();
+  while(it != m_code.end()) {
+    Op       const  op   = static_cast<Op>(*it++);
+    unsigned const  argc = *it++;
+    args.clear();
+    for(unsigned  i = 0; i < argc; i++) {
+      int const  a = *it++;
+      args.push_back((op == Op::CONFIG) || (op == Op::SIGNAL)? a : node(a));
+    }
+
+    switch(op) {
+    case Op::CONFIG:
+    case Op::SIGNAL: {
+      Bus const  bus = op == Op::CONFIG? ctx.allocateConfig(args[0]) : ctx.allocateSignal(args[0]);
+      for(unsigned  i = 0; i < bus.width(); i++)  nodes.push_back(bus[i]);
+      break;
+    }
+    case Op::AND: nodes.push_back(ctx.gateAnd(args[0], args[1]));          break;
+    case Op::XOR: nodes.push_back(ctx.gateXor(args[0], args[1]));          break;
+    case Op::MUX: nodes.push_back(ctx.gateMux(args[0], args[1], args[2])); break;
+    case Op::EQUATE:
+      ctx.equate(args[0], args[1]);
+      break;
+    case Op::CLAUSE:
+      ctx.addClause(args.data(), args.data()+args.size());
+      break;
+    case Op::DECODE: {
+      Bus const  sel = Bus::build(argc, [&args](unsigned const  i) { return  args[i]; });
+      std::vector<int> const &terms = ctx.decode(sel, argc);
+      nodes.insert(nodes.end(), terms.begin(), terms.end());
+      break;
+    }
+    }
+  }
+  scope.copy(m_scope, node);
+}
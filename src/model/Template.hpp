@@ -0,0 +1,96 @@
+/*****************************************************************************
+ * This file is part of the QBM (Quantified Binary Matching) program.
+ *
+ * Copyright (C) 2016
+ *      Thomas B. Preusser <thomas.preusser@utexas.edu>
+ *****************************************************************************
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ ****************************************************************************/
+#ifndef TEMPLATE_HPP
+#define TEMPLATE_HPP
+
+#include "Bus.hpp"
+#include "Scope.hpp"
+
+#include <vector>
+#include <unordered_map>
+
+class Context;
+
+/**
+ * The elaboration of a component instance recorded as the sequence of the
+ * operations it performed so that further instances of the same component
+ * with the same generics and port signature can be elaborated by replaying
+ * them with fresh variables rather than by walking the AST again.
+ *
+ * The operations refer to slots: the port bits come first followed by the
+ * nodes produced by the operations in their order. Slot k is referenced by
+ * the literal k+2 so that Node::TOP and Node::BOT keep their meaning.
+ *
+ * The elaboration must not depend on anything but the generics and on
+ * which port bits are constant or equal to one another. A recording is,
+ * thus, discarded when a gate returns a node from outside the instance,
+ * which the structural hashing may only find by coincidence.
+ */
+class Template {
+public:
+  enum class Op : unsigned char {
+    CONFIG, SIGNAL,   // width -> width fresh nodes
+    AND, XOR, MUX,    // operands -> gate output
+    EQUATE, CLAUSE,   // literals -> nothing
+    DECODE            // selector bits -> minterms
+  };
+
+private:
+  std::vector<int>  m_code;   // op, argument count, arguments
+  unsigned          m_slots;  // slots defined so far
+  Scope             m_scope;  // configs over slot literals
+
+  // Recording State
+  std::unordered_map<int, int>  m_index;  // node -> slot literal
+  std::vector<int>              m_args;   // of the current operation
+  Op                            m_op;
+  int                           m_fresh;  // first signal allocated inside
+  bool                          m_valid;
+
+public:
+  /**
+   * Starts a recording for an instance whose ports are given as the
+   * literals they are resolved to and whose own signals are numbered
+   * from fresh on.
+   */
+  Template(std::vector<int> const &ports, int  fresh);
+  ~Template();
+
+public:
+  bool valid() const { return  m_valid; }
+
+  //- Recording with resolved literals
+public:
+  void step(Op  op, int const *beg, int const *end);
+  void yield(int const *beg, int const *end);
+  /** Completes the recording with the configs registered in the scope. */
+  void finish(Scope const &scope);
+private:
+  int slot(int  lit) const;
+
+  //- Replay
+public:
+  /**
+   * Elaborates another instance connected to the given ports through the
+   * context of its parent. Its configs are registered in the given scope.
+   */
+  void replay(Context &ctx, Scope &scope, std::vector<Bus> const &ports) const;
+};
+#endif
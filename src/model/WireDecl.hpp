@@ -22,15 +22,16 @@
 
 #include "Decl.hpp"
 #include "Expression.hpp"
+#include "Symbol.hpp"
 
 #include <memory>
 
 class WireDecl : public Decl {
-  std::string                const  m_name;
+  Symbol                     const  m_name;
   std::shared_ptr<Expression const> m_width;
 
 public:
-  WireDecl(std::string                const &name,
+  WireDecl(Symbol                     const &name,
 	   std::shared_ptr<Expression const> width)
     : m_name(name), m_width(width) {}
   ~WireDecl();
@@ -39,7 +40,7 @@ public:
   void dump(std::ostream &out) const;
 
 public:
-  std::string const& name()  const { return  m_name; }
+  Symbol      const& name()  const { return  m_name; }
   Expression  const& width() const { return *m_width; }
 };
 #endif
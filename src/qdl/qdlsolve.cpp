@@ -22,23 +22,77 @@
 #include <vector>
 #include <unordered_map>
 #include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
 
 #include "Lib.hpp"
+#include "Ipasir.hpp"
 #include "Root.hpp"
 #include "QdlParser.hpp"
 
 namespace {
   void usage(std::ostream &out, char const *const  prog) {
     out << '\n'<< prog <<
-      " [-tTOP[<PAR0,PAR1,...>]] [-DNAME[=VALUE] ...] [-pFILE]\n\n"
+      " [-tTOP[<PAR0,PAR1,...>]] [-DNAME[=VALUE] ...] [-eENGINE] [-cENCODING] [-sSELECTION] [-mMULTIPLEX] [-ySYMMETRY]\n"
+      "\t[--target TGT[<PAR0,PAR1,...>] ...] [--enumerate[=LIMIT] [--project CFG ...]]\n"
+      "\t[--optimize [--cost CFG[=WEIGHT] ...]] [--cubes[=DEPTH]] [-jTHREADS] [--sat-lib LIB ...] [--qbf-solver CMD]\n"
+      "\t[--preprocess] [-TSECONDS] [-MMEGABYTES] [-pFILE]\n\n"
       "Parse a configurable circuit description from stdin and compute an implementing\n"
       "configuration of the included user target function if it exists.\n\n"
       " TOP\tname of the top-level module defining the circuit, default: top\n"
       " PARi\tnumeric generic parameters passed to the top-level module, default: none\n"
+      " TGT\ttarget function matched by the top-level module in batch mode, the module\n"
+      "\tthen only describes the structure whose ports the targets share\n"
+      " LIMIT\tenumerate up to LIMIT implementing configurations, default: all\n"
+      " CFG\tconfig bus (e.g. lut/c) or instance (e.g. lut/) distinguishing the\n"
+      "\tenumerated configurations, default: all configs\n"
+      " WEIGHT\tcost of each set config bit in CFG minimized by --optimize, default: 1,\n"
+      "\tall config bits cost one without any --cost\n"
+      " DEPTH\tnumber of config bits split into the initial cubes solved in parallel\n"
+      "\tby --cubes, default: enough cubes to keep all threads busy\n"
+      " THREADS\tnumber of threads elaborating the instances of TOP and conquering\n"
+      "\tthe cubes, default: one per core\n"
       " NAME\tmacro definition with optional VALUE for expansion before parsing\n"
-      " FILE\tprint qdimacs formulation to FILE rather than solving the problem\n"
+      " ENGINE\tsolution engine: quantor (default), cegar, expand or portfolio\n"
+      " ENCODING\tgate encoding: full (default) or polarity\n"
+      " SELECTION\tCHOOSE encoding: enumerate (default) or ordered,\n"
+      "\tcomponents may override it by the constant CHOOSE_ENCODING = 0 or 1\n"
+      " MULTIPLEX\tSEL encoding: clauses (default), tree or decoder,\n"
+      "\tcomponents may override it by the constant SEL_ENCODING = 0, 1 or 2\n"
+      " SYMMETRY\tinterchangeable instances: keep (default) or break\n"
+      " LIB\tIPASIR SAT solver library loaded for the cegar and expand engines,\n"
+      "\tthe portfolio races them on each given library\n"
+      " CMD\tshell command of an external QBF solver reading QDIMACS from stdin and\n"
+      "\tprinting its certificate by V lines, replaces the solution engine\n"
+      " SECONDS\twall-clock time budget of the solution engine, default: unlimited\n"
+      " MEGABYTES\tresident memory budget of the process, default: unlimited\n"
+      " FILE\tprint qdimacs formulation to FILE rather than solving the problem,\n"
+      "\tthe expand engine prints the expanded dimacs formulation instead\n"
 	<< std::endl;
   }
+
+  /** Parses a component instance NAME[<PAR0,PAR1,...>]. */
+  bool parseInstance(char const *arg, std::string &name, std::vector<int> &generics) {
+    char     *id  = nullptr;
+    unsigned  end = 0;
+    if(sscanf(arg, " %m[A-Za-z_0-9] < %n", &id, &end) < 1)  return  false;
+    name = id;
+    free(id);
+
+    generics.clear();
+    while(end) {
+      int   param;
+      char  sep;
+      arg += end;
+      end  = 0;
+      if((sscanf(arg, "%d %c %n", &param, &sep, &end) < 2) ||
+	 ((sep != ',') && (sep != '>')))  return  false;
+      generics.emplace_back(param);
+      if(sep == '>')  end = 0;
+    }
+    return  true;
+  }
 }
 
 
@@ -49,6 +103,25 @@ int main(int const  argc, char const *const  argv[]) {
   std::string       top("top"); // top-level name
   std::vector<int>  generics;   // top-level params
   char const       *qdimacs = 0;
+  Root::Engine      engine  = Root::Engine::QUANTOR;
+  Root::Encoding    encoding = Root::Encoding::FULL;
+  Root::Selection   selection = Root::Selection::ENUMERATE;
+  Root::Multiplex   multiplex = Root::Multiplex::CLAUSES;
+  Root::Symmetry    symmetry  = Root::Symmetry::KEEP;
+  std::vector<char const*>  targets; // batch of target functions
+  bool              enumerate = false;
+  unsigned long     limit     = 0;  // maximum number of enumerated configs
+  std::vector<std::string>  projection; // configs to enumerate
+  bool              optimize  = false;
+  std::vector<Root::Cost>   costs;      // weights to minimize
+  bool              cubes     = false;
+  bool              preprocess = false;
+  unsigned          depth     = 0;  // initial splitting bits
+  unsigned          threads   = 0;  // elaboration and cube-and-conquer workers
+  std::vector<char const*>  satlibs; // IPASIR libraries to load
+  char const       *qbfsolver = 0;  // external solver command
+  double            seconds   = 0;  // time budget
+  unsigned long     megabytes = 0;  // memory budget
 
 
   // Extract parameters passed via the command line
@@ -56,6 +129,71 @@ int main(int const  argc, char const *const  argv[]) {
     char const *arg = argv[i++];
 
     if(arg[0] == '-') {
+      // Long Options
+      if(strncmp(arg, "--sat-lib", 9) == 0) {
+	if(arg[9] == '=')  satlibs.push_back(arg+10);
+	else if((arg[9] == '\0') && (i < argc))  satlibs.push_back(argv[i++]);
+	else  goto  err;
+	continue;
+      }
+      if(strncmp(arg, "--target", 8) == 0) {
+	if(arg[8] == '=')  targets.push_back(arg+9);
+	else if((arg[8] == '\0') && (i < argc))  targets.push_back(argv[i++]);
+	else  goto  err;
+	continue;
+      }
+      if(strncmp(arg, "--enumerate", 11) == 0) {
+	unsigned  end = 0;
+	if(arg[11] == '=') {
+	  if((sscanf(arg+12, "%lu%n", &limit, &end) < 1) || arg[12+end])  goto  err;
+	}
+	else if(arg[11] != '\0')  goto  err;
+	enumerate = true;
+	continue;
+      }
+      if(strncmp(arg, "--project", 9) == 0) {
+	if(arg[9] == '=')  projection.emplace_back(arg+10);
+	else if((arg[9] == '\0') && (i < argc))  projection.emplace_back(argv[i++]);
+	else  goto  err;
+	continue;
+      }
+      if(strcmp(arg, "--optimize") == 0) {
+	optimize = true;
+	continue;
+      }
+      if(strncmp(arg, "--cost", 6) == 0) {
+	char const *spec;
+	if(arg[6] == '=')  spec = arg+7;
+	else if((arg[6] == '\0') && (i < argc))  spec = argv[i++];
+	else  goto  err;
+
+	char const *const  eq = strrchr(spec, '=');
+	unsigned  weight = 1;
+	unsigned  end    = 0;
+	if(eq && ((sscanf(eq+1, "%u%n", &weight, &end) < 1) || eq[1+end]))  goto  err;
+	costs.push_back(Root::Cost{eq? std::string(spec, eq) : std::string(spec), weight});
+	continue;
+      }
+      if(strncmp(arg, "--cubes", 7) == 0) {
+	unsigned  end = 0;
+	if(arg[7] == '=') {
+	  if((sscanf(arg+8, "%u%n", &depth, &end) < 1) || arg[8+end])  goto  err;
+	}
+	else if(arg[7] != '\0')  goto  err;
+	cubes = true;
+	continue;
+      }
+      if(strcmp(arg, "--preprocess") == 0) {
+	preprocess = true;
+	continue;
+      }
+      if(strncmp(arg, "--qbf-solver", 12) == 0) {
+	if(arg[12] == '=')  qbfsolver = arg+13;
+	else if((arg[12] == '\0') && (i < argc))  qbfsolver = argv[i++];
+	else  goto  err;
+	continue;
+      }
+
       char const  opt = arg[1];
       if((opt == '?') || (opt == 'h')) {
 	usage(std::cout, *argv);
@@ -78,20 +216,7 @@ int main(int const  argc, char const *const  argv[]) {
 	switch(opt) {
 	  // User-defined top-level module with optional generics
 	case 't':
-	  sscanf(arg, " %m[A-Za-z_0-9] < %n", &name, &end);
-	  top = name;
-	  free(name);
-
-	  while(end) {
-	    int   param;
-	    char  sep;
-	    arg += end;
-	    end  = 0;
-	    if((sscanf(arg, "%d %c %n", &param, &sep, &end) < 2) ||
-	       ((sep != ',') && (sep != '>')))  goto  err;
-	    generics.emplace_back(param);
-	    if(sep == '>')  end = 0;
-	  }
+	  if(!parseInstance(arg, top, generics))  goto  err;
 	  continue;
 
 	  // User-defined macro definitions
@@ -101,6 +226,57 @@ int main(int const  argc, char const *const  argv[]) {
 	  free(name);
 	  continue;
 
+	  // Select the solution engine
+	case 'e':
+	  if(strcmp(arg, "quantor") == 0)         engine = Root::Engine::QUANTOR;
+	  else if(strcmp(arg, "cegar") == 0)      engine = Root::Engine::CEGAR;
+	  else if(strcmp(arg, "expand") == 0)     engine = Root::Engine::EXPANSION;
+	  else if(strcmp(arg, "portfolio") == 0)  engine = Root::Engine::PORTFOLIO;
+	  else  goto  err;
+	  continue;
+
+	  // Select the gate encoding
+	case 'c':
+	  if(strcmp(arg, "full") == 0)          encoding = Root::Encoding::FULL;
+	  else if(strcmp(arg, "polarity") == 0) encoding = Root::Encoding::POLARITY;
+	  else  goto  err;
+	  continue;
+
+	  // Select the encoding of CHOOSE<k>
+	case 's':
+	  if(strcmp(arg, "enumerate") == 0)     selection = Root::Selection::ENUMERATE;
+	  else if(strcmp(arg, "ordered") == 0)  selection = Root::Selection::ORDERED;
+	  else  goto  err;
+	  continue;
+
+	  // Select the encoding of SEL
+	case 'm':
+	  if(strcmp(arg, "clauses") == 0)       multiplex = Root::Multiplex::CLAUSES;
+	  else if(strcmp(arg, "tree") == 0)     multiplex = Root::Multiplex::TREE;
+	  else if(strcmp(arg, "decoder") == 0)  multiplex = Root::Multiplex::DECODER;
+	  else  goto  err;
+	  continue;
+
+	  // Treatment of interchangeable instances
+	case 'y':
+	  if(strcmp(arg, "keep") == 0)        symmetry = Root::Symmetry::KEEP;
+	  else if(strcmp(arg, "break") == 0)  symmetry = Root::Symmetry::BREAK;
+	  else  goto  err;
+	  continue;
+
+	  // Threads of cube and conquer
+	case 'j':
+	  if((sscanf(arg, "%u%n", &threads, &end) < 1) || arg[end])  goto  err;
+	  continue;
+
+	  // Resource budgets
+	case 'T':
+	  if((sscanf(arg, "%lf%n", &seconds, &end) < 1) || arg[end] || (seconds < 0))  goto  err;
+	  continue;
+	case 'M':
+	  if((sscanf(arg, "%lu%n", &megabytes, &end) < 1) || arg[end])  goto  err;
+	  continue;
+
 	  // Print qdimacs formulation to file
 	case 'p':
 	  qdimacs = arg;
@@ -113,11 +289,50 @@ int main(int const  argc, char const *const  argv[]) {
     return  1;
   }
 
+  // Reject unsupported combinations before the elaboration
+  if(!qdimacs) {
+    bool const  incremental = (engine == Root::Engine::CEGAR) || (engine == Root::Engine::EXPANSION);
+    char const *error = 0;
+    if(optimize) {
+      if(qbfsolver || enumerate || !targets.empty())  error = "Optimization is not supported by external solvers, in enumeration or in batch mode.";
+      else if(!incremental)  error = "Optimization requires an incremental engine: cegar or expand.";
+      else if(symmetry == Root::Symmetry::BREAK)  error = "Symmetry breaking may exclude the cheapest configurations.";
+    }
+    else if(enumerate) {
+      if(qbfsolver || !targets.empty())  error = "Enumeration is not supported by external solvers or in batch mode.";
+      else if(!incremental)  error = "Enumeration requires an incremental engine: cegar or expand.";
+      else if(symmetry == Root::Symmetry::BREAK)  error = "Enumeration would only count configurations up to symmetry.";
+    }
+    else if(!targets.empty()) {
+      if(qbfsolver)  error = "Batch matching is not supported by external solvers.";
+      else if(!incremental)  error = "Batch matching requires an incremental engine: cegar or expand.";
+    }
+    else if(cubes) {
+      if(qbfsolver)  error = "Cube and conquer is not supported by external solvers.";
+      else if(!incremental)  error = "Cube and conquer requires an incremental engine: cegar or expand.";
+    }
+    if(error) {
+      std::cerr << "Error:\n\t" << error << std::endl;
+      return  1;
+    }
+  }
+
   // Parse and solve input from stdin
   try {
     Lib  lib;
     QdlParser(std::cin, std::move(defines), lib);
-    Root  root(lib.resolveComponent(top), generics);
+    std::vector<Root::Target>  batch;
+    for(char const *target : targets) {
+      std::string       name;
+      std::vector<int>  params;
+      if(!parseInstance(target, name, params)) {
+	std::cerr << "Cannot parse target: \"" << target << '"' << std::endl;
+	return  1;
+      }
+      batch.push_back(Root::Target{&lib.resolveComponent(name), std::move(params)});
+    }
+    Root  root(lib.resolveComponent(top), generics, batch, encoding, selection, multiplex, symmetry, threads);
+    if(preprocess)  root.preprocess();
     //root.dumpClauses(std::cerr);
 
     if(qdimacs) {
@@ -125,15 +340,66 @@ int main(int const  argc, char const *const  argv[]) {
       std::cerr << std::endl << "Dumping problem to file '" << qdimacs << '\'' << std::endl;;
 
       std::ofstream  out(qdimacs);
-      root.dumpQDimacs(out);
+      if(engine == Root::Engine::EXPANSION)  root.dumpDimacs(out);
+      else  root.dumpQDimacs(out);
     }
     else {
       // Solve the posed problem
       std::cerr << std::endl << "Solving ... ";
 
-      Result const  res = root.solve();
-      std::cout << res << std::endl;
-      if(res)  root.printConfig(std::cout);
+      std::vector<qbm::IpasirLib>  backends;
+      for(char const *lib : satlibs)  backends.emplace_back(lib);
+
+      qbm::Budget const  budget(seconds, megabytes);
+      if(optimize) {
+	// Report improving configurations anytime
+	unsigned long  best = 0;
+	Result const  res = root.optimize(engine, backends, budget, costs,
+					  [&root, &best](unsigned long  cost) {
+					    std::cout << "cost " << cost << std::endl;
+					    root.printConfig(std::cout);
+					    best = cost;
+					  });
+	if(res == QUANTOR_RESULT_SATISFIABLE)  std::cout << "optimal cost " << best << std::endl;
+	else  std::cout << res << std::endl;
+      }
+      else if(enumerate) {
+	// Stream the configurations as they are found
+	unsigned long  count = 0;
+	Result const  res = root.enumerate(engine, backends, budget, projection, limit,
+					   [&root, &count](unsigned long  n) {
+					     std::cout << "#" << n << std::endl;
+					     root.printConfig(std::cout);
+					     count = n;
+					   });
+	std::cout << count << " configuration(s)";
+	if(res == QUANTOR_RESULT_UNSATISFIABLE)     std::cout << ", complete";
+	else if(res == QUANTOR_RESULT_SATISFIABLE)  std::cout << ", limit reached";
+	else  std::cout << ", " << res;
+	std::cout << std::endl;
+      }
+      else if(!targets.empty()) {
+	// Match all targets with the structure elaborated once
+	auto const  start = std::chrono::steady_clock::now();
+	root.solveBatch(engine, backends, budget, [&root, &targets](unsigned  k, Result  res) {
+	    std::cout << targets[k] << ": " << res << std::endl;
+	    if(res)  root.printConfig(std::cout);
+	  });
+	double const  secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << targets.size() << " target(s) in " << secs << "s: "
+		  << (targets.size() / secs) << " targets/s" << std::endl;
+      }
+      else if(cubes) {
+	// Conquer the cubes over the config space in parallel
+	Result const  res = root.solveCubes(engine, backends, budget, threads, depth);
+	std::cout << res << std::endl;
+	if(res)  root.printConfig(std::cout);
+      }
+      else {
+	Result const  res = qbfsolver? root.solve(qbfsolver, budget) : root.solve(engine, backends, budget);
+	std::cout << res << std::endl;
+	if(res)  root.printConfig(std::cout);
+      }
     }
   }
   catch(char const *const  msg) {
@@ -143,4 +409,9 @@ int main(int const  argc, char const *const  argv[]) {
     std::cerr << "Error:\n\t" << msg << std::endl;
   }
 
+  // Engines left running in the background must not outlive static objects
+  if(Root::detached() > 0) {
+    std::cout.flush();
+    std::quick_exit(0);
+  }
 } // main()